@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <core/global/globals.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <helper/audio/linux/backend.hpp>
+#endif
+
+//* Measures how long it takes from a hotkey press until the sound reaches the device. Everything runs headless on
+//* miniaudio's null backend, the report is printed as json so it can be compared between runs.
+
+namespace
+{
+    std::atomic<std::uint64_t> allocations = 0;
+    thread_local bool countAllocations = false;
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    if (countAllocations)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (auto *ptr = std::malloc(size ? size : 1); ptr) // NOLINT
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr); // NOLINT
+}
+void operator delete(void *ptr, [[maybe_unused]] std::size_t size) noexcept
+{
+    std::free(ptr); // NOLINT
+}
+
+namespace
+{
+    using namespace Soundux::Objects; // NOLINT
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int firstKey = 10000; //* Far away from any real key code
+    constexpr std::uint32_t sampleRate = 48000;
+    constexpr double pi = 3.14159265358979323846;
+
+    class BenchmarkWindow : public Window
+    {
+      public:
+        std::atomic<std::uint64_t> errors = 0;
+
+        void show() override {}
+        void mainLoop() override {}
+
+        void onAdminRequired() override {}
+        void onSettingsChanged() override {}
+        void onSwitchOnConnectDetected(bool) override {}
+        void onError(const Soundux::Enums::ErrorCode &) override
+        {
+            errors++;
+        }
+        void onSoundsProgressed(const std::vector<PlayingSound> &) override {}
+        void onDownloadProgressed(float, const std::string &) override {}
+    };
+
+#if defined(__linux__)
+    class NullBackend : public AudioBackend
+    {
+      protected:
+        bool setup() override
+        {
+            return true;
+        }
+
+      public:
+        void destroy() override {}
+        bool useAsDefault() override
+        {
+            return false;
+        }
+        bool revertDefault() override
+        {
+            return false;
+        }
+        bool muteInput(bool) override
+        {
+            return false;
+        }
+
+        std::set<std::string> currentlyInputApps() override
+        {
+            return {};
+        }
+        std::set<std::string> currentlyPassedThrough() override
+        {
+            return {};
+        }
+
+        bool stopAllPassthrough() override
+        {
+            return false;
+        }
+        bool stopPassthrough(const std::string &) override
+        {
+            return false;
+        }
+        bool passthroughFrom(std::shared_ptr<PlaybackApp>) override
+        {
+            return false;
+        }
+
+        bool stopSoundInput() override
+        {
+            return false;
+        }
+        bool inputSoundTo(std::shared_ptr<RecordingApp>) override
+        {
+            return false;
+        }
+
+        std::shared_ptr<PlaybackApp> getPlaybackApp(const std::string &) override
+        {
+            return nullptr;
+        }
+        std::shared_ptr<RecordingApp> getRecordingApp(const std::string &) override
+        {
+            return nullptr;
+        }
+
+        std::vector<std::shared_ptr<PlaybackApp>> getPlaybackApps() override
+        {
+            return {};
+        }
+        std::vector<std::shared_ptr<RecordingApp>> getRecordingApps() override
+        {
+            return {};
+        }
+    };
+#endif
+
+    //* Two seconds of a stereo sine, every sound gets its own pitch
+    void writeSound(const std::filesystem::path &path, double frequency)
+    {
+        constexpr std::uint32_t frames = sampleRate * 2;
+        constexpr std::uint16_t channels = 2;
+        constexpr std::uint32_t dataSize = frames * channels * sizeof(std::int16_t);
+
+        std::ofstream file(path, std::ios::binary);
+        auto put = [&](auto value) { file.write(reinterpret_cast<const char *>(&value), sizeof(value)); };
+
+        file.write("RIFF", 4);
+        put(static_cast<std::uint32_t>(36 + dataSize));
+        file.write("WAVEfmt ", 8);
+        put(static_cast<std::uint32_t>(16));
+        put(static_cast<std::uint16_t>(1));
+        put(channels);
+        put(sampleRate);
+        put(static_cast<std::uint32_t>(sampleRate * channels * sizeof(std::int16_t)));
+        put(static_cast<std::uint16_t>(channels * sizeof(std::int16_t)));
+        put(static_cast<std::uint16_t>(16));
+        file.write("data", 4);
+        put(dataSize);
+
+        for (std::uint32_t i = 0; frames > i; i++)
+        {
+            const auto sample = static_cast<std::int16_t>(
+                std::sin(2.0 * pi * frequency * static_cast<double>(i) / sampleRate) * 16384.0);
+            put(sample);
+            put(sample);
+        }
+    }
+
+    template <typename Predicate> bool waitFor(Predicate predicate, std::chrono::milliseconds timeout)
+    {
+        const auto deadline = Clock::now() + timeout;
+        while (!predicate())
+        {
+            if (Clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return true;
+    }
+
+    nlohmann::json summarize(std::vector<double> samples)
+    {
+        if (samples.empty())
+        {
+            return nullptr;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&](double p) {
+            auto index = static_cast<std::size_t>(std::ceil(p * static_cast<double>(samples.size())));
+            return samples[std::clamp<std::size_t>(index, 1, samples.size()) - 1];
+        };
+
+        return {{"p50", percentile(0.5)}, {"p99", percentile(0.99)}, {"max", samples.back()}};
+    }
+} // namespace
+
+int main(int argc, char **arguments)
+{
+    using namespace Soundux::Globals; // NOLINT
+
+    std::uint32_t soundCount = 8;
+    std::uint32_t overlaps = 1;
+    std::uint32_t repetitions = 100;
+    bool preload = false;
+    std::string output;
+
+    std::vector<std::string> args(arguments + 1, arguments + argc);
+    for (std::size_t i = 0; args.size() > i; i++)
+    {
+        const auto hasValue = i + 1 < args.size();
+        if (args[i] == "--sounds" && hasValue)
+        {
+            soundCount = std::max(1, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--overlaps" && hasValue)
+        {
+            overlaps = std::max(1, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--repetitions" && hasValue)
+        {
+            repetitions = std::max(1, std::stoi(args[++i]));
+        }
+        else if (args[i] == "--output" && hasValue)
+        {
+            output = args[++i];
+        }
+        else if (args[i] == "--preload")
+        {
+            preload = true;
+        }
+        else
+        {
+            std::cerr << "Usage: soundux-latency-benchmark [--sounds N] [--overlaps M] [--repetitions K] [--preload] "
+                         "[--output file.json]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    const auto directory = std::filesystem::temp_directory_path() / "soundux-latency-benchmark";
+    std::filesystem::create_directories(directory);
+
+    Tab tab;
+    tab.name = "Benchmark";
+    tab.path = directory.string();
+    for (std::uint32_t i = 0; soundCount > i; i++)
+    {
+        const auto path = directory / ("sound-" + std::to_string(i) + ".wav");
+        writeSound(path, 220.0 * (1.0 + 0.25 * i));
+
+        Sound sound;
+        sound.id = ++gData.soundIdCounter;
+        sound.name = path.filename().string();
+        sound.path = path.string();
+        sound.hotkeys = {firstKey + static_cast<int>(i)};
+        sound.modifiedDate = 0;
+        tab.sounds.emplace_back(sound);
+    }
+    gData.setRegistry(&gSounds);
+    gData.addTab(tab);
+
+    gSettings.allowOverlapping = true;
+    gSettings.tabHotkeysOnly = false;
+    gSettings.muteDuringPlayback = false;
+    gSettings.useAsDefaultDevice = false;
+    gSettings.outputs.clear();
+    gSettings.pushToTalkKeys.clear();
+    gSettings.stopHotkey.clear();
+
+#if defined(__linux__)
+    gAudioBackend = std::make_shared<NullBackend>();
+#endif
+    gAudio.useNullBackend();
+    gAudio.setup();
+
+    auto window = std::make_unique<BenchmarkWindow>();
+    auto *benchmarkWindow = window.get();
+    gGui = std::move(window);
+
+    if (preload)
+    {
+        //* There is no way to tell when the cache is done, the sounds are short enough for this to be plenty
+        gAudio.preload(tab.sounds);
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+    }
+
+    std::vector<double> latencies;    //* Hotkey until the device got sound, in ms
+    std::vector<double> triggerTimes; //* Time spent in onKeyDown, in ms
+    std::uint64_t allocated = 0;
+    std::uint64_t missed = 0;
+
+    for (std::uint32_t repetition = 0; repetitions > repetition; repetition++)
+    {
+        //* Every repetition starts from silence, otherwise there is no transition to detect
+        gAudio.stopAll();
+        waitFor([] { return gAudio.getPlayingSounds().empty(); }, std::chrono::seconds(2));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        const auto start = Clock::now();
+        const auto startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+
+        for (std::uint32_t overlap = 0; overlaps > overlap; overlap++)
+        {
+            const auto key = firstKey + static_cast<int>((repetition * overlaps + overlap) % soundCount);
+
+            const auto before = Clock::now();
+            allocations = 0;
+            countAllocations = true;
+            gHotKeys.onKeyDown(key);
+            countAllocations = false;
+            const auto after = Clock::now();
+
+            gHotKeys.onKeyUp(key);
+
+            triggerTimes.emplace_back(std::chrono::duration<double, std::milli>(after - before).count());
+            allocated += allocations;
+        }
+
+        if (waitFor([&] { return gAudio.getAudibleAt() >= startNs; }, std::chrono::seconds(1)))
+        {
+            latencies.emplace_back(static_cast<double>(gAudio.getAudibleAt() - startNs) / 1e6);
+        }
+        else
+        {
+            missed++;
+        }
+    }
+
+    gAudio.stopAll();
+
+    nlohmann::json callbacks = nlohmann::json::array();
+    for (const auto &info : gAudio.getOutputInfo())
+    {
+        callbacks.push_back({
+            {"output", info.name},
+            {"periodSize", info.periodSize},
+            {"sampleRate", info.sampleRate},
+            {"callbacks", info.callbacks},
+            {"averageUs", info.callbackTime},
+        });
+    }
+
+    nlohmann::json report = {
+        {"sounds", soundCount},
+        {"overlaps", overlaps},
+        {"repetitions", repetitions},
+        {"preload", preload},
+        {"latencyMs", summarize(latencies)},
+        {"triggerMs", summarize(triggerTimes)},
+        {"allocationsPerTrigger", static_cast<double>(allocated) / static_cast<double>(triggerTimes.size())},
+        {"missed", missed},
+        {"errors", benchmarkWindow->errors.load()},
+        {"callbacks", callbacks},
+    };
+
+    gAudio.destroy();
+    gGui.reset();
+
+    std::error_code ec;
+    std::filesystem::remove_all(directory, ec);
+
+    if (!output.empty())
+    {
+        std::ofstream(output) << report.dump(4) << std::endl;
+    }
+    else
+    {
+        std::cout << report.dump(4) << std::endl;
+    }
+
+    return missed ? 2 : 0;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <helper/audio/dsp/dsp.hpp>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Soundux::Helpers::SimdLevel;
+
+namespace
+{
+    constexpr std::size_t periodFrames = 512;
+    constexpr std::size_t iterations = 200000;
+
+    const char *name(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            return "avx2";
+        case SimdLevel::SSE2:
+            return "sse2";
+        default:
+            return "scalar";
+        }
+    }
+
+    template <typename T> std::vector<float> run(SimdLevel level, const std::vector<T> &source, double &nsPerFrame)
+    {
+        Soundux::Helpers::setSimdLevel(level);
+        std::vector<float> output(periodFrames * 2, 0.f);
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; iterations > i; i++)
+        {
+            //* Alternate between a ramp and a constant gain like the mixer does
+            const auto gain = (i % 2) ? 0.5f : 0.25f;
+            Soundux::Helpers::mixStereo(output.data(), source.data(), periodFrames, gain, 0.5f);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        nsPerFrame = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+                     static_cast<double>(iterations * periodFrames);
+
+        return output;
+    }
+
+    template <typename T> void benchmark(const char *format, const std::vector<T> &source)
+    {
+        double scalarTime = 0;
+        auto reference = run(SimdLevel::Scalar, source, scalarTime);
+
+        std::cout << format << " scalar: " << std::fixed << std::setprecision(3) << scalarTime << " ns/frame"
+                  << std::endl;
+
+        for (auto level : {SimdLevel::SSE2, SimdLevel::AVX2})
+        {
+            if (level > Soundux::Helpers::getSupportedSimdLevel())
+            {
+                std::cout << format << " " << name(level) << ": not supported" << std::endl;
+                continue;
+            }
+
+            double time = 0;
+            auto result = run(level, source, time);
+
+            float error = 0;
+            for (std::size_t i = 0; result.size() > i; i++)
+            {
+                error = std::max(error, std::abs(result[i] - reference[i]) / std::max(1.f, std::abs(reference[i])));
+            }
+
+            std::cout << format << " " << name(level) << ": " << time << " ns/frame, " << scalarTime / time
+                      << "x faster, max relative error " << std::scientific << error << std::fixed << std::endl;
+        }
+    }
+} // namespace
+
+int main()
+{
+    std::mt19937 random(1337);
+    std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+
+    std::vector<float> f32(periodFrames * 2);
+    std::vector<std::int16_t> s16(periodFrames * 2);
+    for (std::size_t i = 0; f32.size() > i; i++)
+    {
+        f32[i] = distribution(random);
+        s16[i] = static_cast<std::int16_t>(f32[i] * 32767.f);
+    }
+
+    benchmark("f32", f32);
+    benchmark("s16", s16);
+
+    return 0;
+}
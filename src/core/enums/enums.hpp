@@ -53,6 +53,26 @@ namespace Soundux
             EmulatedLaunchpad,
         };
 
+        enum class ResampleQuality : std::uint8_t
+        {
+            Linear,
+            Sinc,
+        };
+
+        enum class VoiceStealing : std::uint8_t
+        {
+            Oldest,
+            Quietest,
+            LowestPriority,
+        };
+
+        enum class LimiterMode : std::uint8_t
+        {
+            Off,
+            SoftClip,
+            Lookahead,
+        };
+
         enum class BackendType : std::uint8_t
         {
             None,
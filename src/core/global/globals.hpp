@@ -1,5 +1,6 @@
 #pragma once
 #include <helper/audio/audio.hpp>
+#include <helper/audio/waveform/waveform.hpp>
 #if defined(__linux__)
 #include <helper/audio/linux/backend.hpp>
 #elif defined(_WIN32)
@@ -9,6 +10,7 @@
 #include <core/hotkeys/hotkeys.hpp>
 #include <core/objects/data.hpp>
 #include <core/objects/objects.hpp>
+#include <core/objects/registry.hpp>
 #include <core/objects/settings.hpp>
 #include <guard.hpp>
 #include <helper/icons/icons.hpp>
@@ -16,7 +18,6 @@
 #include <helper/ytdl/youtube-dl.hpp>
 #include <memory>
 #include <ui/ui.hpp>
-#include <var_guard.hpp>
 
 namespace Soundux
 {
@@ -30,6 +31,8 @@ namespace Soundux
 #elif defined(_WIN32)
         inline std::shared_ptr<Objects::WinSound> gWinSound;
 #endif
+        //* Declared before the queue, whose background tasks still use it until the queue is destroyed
+        inline Objects::Waveforms gWaveforms;
         inline Objects::Queue gQueue;
         inline Objects::Config gConfig;
         inline Objects::YoutubeDl gYtdl;
@@ -40,7 +43,6 @@ namespace Soundux
         inline std::shared_ptr<Instance::Guard> gGuard;
 
         /* Allows for fast & easy sound access, is populated on start up */
-        inline sxl::var_guard<std::map<std::uint32_t, std::reference_wrapper<Objects::Sound>>> gSounds;
-        inline sxl::var_guard<std::map<std::uint32_t, std::reference_wrapper<Objects::Sound>>> gFavorites;
+        inline Objects::SoundRegistry gSounds;
     } // namespace Globals
 } // namespace Soundux
\ No newline at end of file
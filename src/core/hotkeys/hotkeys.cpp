@@ -4,19 +4,6 @@
 
 namespace Soundux
 {
-    namespace traits
-    {
-        template <typename T> struct is_pair
-        {
-          private:
-            static std::uint8_t test(...);
-            template <typename O>
-            static auto test(O *) -> decltype(std::declval<O>().first, std::declval<O>().second, std::uint16_t{});
-
-          public:
-            static const bool value = sizeof(test(reinterpret_cast<T *>(0))) == sizeof(std::uint16_t);
-        };
-    } // namespace traits
     namespace Objects
     {
         void Hotkeys::init()
@@ -59,40 +46,38 @@ namespace Soundux
             }
             return false;
         }
-        template <typename T> std::optional<Sound> getBestMatch(const T &list, const std::vector<int> &pressedKeys)
+        //* Returns true once a sound matches exactly, nothing can beat that
+        bool updateBestMatch(std::optional<Sound> &rtn, const Sound &sound, const std::vector<int> &pressedKeys)
         {
-            std::optional<Sound> rtn;
+            if (sound.hotkeys.empty())
+                return false;
 
-            for (const auto &_sound : list)
+            if (sound.hotkeys == pressedKeys)
             {
-                const auto &sound = [&] {
-                    if constexpr (traits::is_pair<std::decay_t<decltype(_sound)>>::value)
-                    {
-                        return _sound.second.get();
-                    }
-                    else
-                    {
-                        return _sound;
-                    }
-                }();
-
-                if (sound.hotkeys.empty())
-                    continue;
+                rtn = sound;
+                return true;
+            }
 
-                if (sound.hotkeys == pressedKeys)
-                {
-                    rtn = sound;
-                    break;
-                }
+            if (rtn && rtn->hotkeys.size() > sound.hotkeys.size())
+            {
+                return false;
+            }
 
-                if (rtn && rtn->hotkeys.size() > sound.hotkeys.size())
-                {
-                    continue;
-                }
+            if (isCloseMatch(pressedKeys, sound.hotkeys))
+            {
+                rtn = sound;
+            }
+            return false;
+        }
+        std::optional<Sound> getBestMatch(const std::vector<Sound> &list, const std::vector<int> &pressedKeys)
+        {
+            std::optional<Sound> rtn;
 
-                if (isCloseMatch(pressedKeys, sound.hotkeys))
+            for (const auto &sound : list)
+            {
+                if (updateBestMatch(rtn, sound, pressedKeys))
                 {
-                    rtn = sound;
+                    break;
                 }
             }
             return rtn;
@@ -144,8 +129,8 @@ namespace Soundux
             }
             else
             {
-                auto scopedSounds = Globals::gSounds.scoped();
-                bestMatch = getBestMatch(*scopedSounds, pressedKeys);
+                Globals::gSounds.forEach(
+                    [&](const Sound &sound) { return updateBestMatch(bestMatch, sound, pressedKeys); });
             }
 
             if (bestMatch)
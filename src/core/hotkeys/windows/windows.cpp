@@ -99,8 +99,14 @@ namespace Soundux::Objects
         UnhookWindowsHookEx(oMouseProc);
         UnhookWindowsHookEx(oKeyBoardProc);
         PostThreadMessage(GetThreadId(listener.native_handle()), WM_QUIT, 0, 0);
-        listener.join();
-        keyPressThread.join();
+        if (listener.joinable())
+        {
+            listener.join();
+        }
+        if (keyPressThread.joinable())
+        {
+            keyPressThread.join();
+        }
     }
 
     std::string Hotkeys::getKeyName(const int &key)
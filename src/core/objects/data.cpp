@@ -1,39 +1,118 @@
 #include "data.hpp"
-#include <core/global/globals.hpp>
+#include "registry.hpp"
+#include <algorithm>
 #include <fancy.hpp>
+#include <tuple>
+#include <unordered_map>
 
 namespace Soundux::Objects
 {
-    Tab Data::addTab(Tab tab)
+    namespace
     {
-        tab.id = tabs.size();
-        tabs.emplace_back(tab);
+        template <typename T, typename Compare>
+        bool isSame(const std::optional<T> &left, const std::optional<T> &right, Compare compare)
+        {
+            return left.has_value() == right.has_value() && (!left || compare(*left, *right));
+        }
+        bool isSame(const Sound &left, const Sound &right)
+        {
+            return std::tie(left.name, left.path, left.isFavorite, left.hotkeys, left.modifiedDate, left.localVolume,
+                            left.remoteVolume, left.priority) ==
+                       std::tie(right.name, right.path, right.isFavorite, right.hotkeys, right.modifiedDate,
+                                right.localVolume, right.remoteVolume, right.priority) &&
+                   isSame(left.loop, right.loop,
+                          [](const LoopRegion &l, const LoopRegion &r) {
+                              return std::tie(l.start, l.end, l.crossfade) == std::tie(r.start, r.end, r.crossfade);
+                          }) &&
+                   isSame(left.loudness, right.loudness,
+                          [](const Loudness &l, const Loudness &r) {
+                              return std::tie(l.integrated, l.truePeak) == std::tie(r.integrated, r.truePeak);
+                          }) &&
+                   isSame(left.metadata, right.metadata, [](const Metadata &l, const Metadata &r) {
+                       return std::tie(l.frames, l.sampleRate, l.channels, l.codec, l.bitrate) ==
+                              std::tie(r.frames, r.sampleRate, r.channels, r.codec, r.bitrate);
+                   });
+        }
+    } // namespace
+
+    void Data::setRegistry(SoundRegistry *newRegistry)
+    {
+        registry = newRegistry;
+    }
+    //* Only sounds that are new or changed are written to the registry and only dropped ones are erased
+    void Data::reindex(const std::vector<Tab> &before, const std::vector<Tab> &after)
+    {
+        if (!registry)
+        {
+            return;
+        }
 
-        for (auto &sound : tabs.back().sounds)
+        std::unordered_map<std::uint32_t, const Sound *> previous;
+        for (const auto &tab : before)
         {
-            Globals::gSounds->insert({sound.id, sound});
-            if (sound.isFavorite)
+            for (const auto &sound : tab.sounds)
             {
-                Globals::gFavorites->insert({sound.id, sound});
+                previous.emplace(sound.id, &sound);
             }
         }
 
-        return tabs.back();
-    }
-    void Data::removeTabById(const std::uint32_t &index)
-    {
-        if (tabs.size() > index)
+        for (const auto &tab : after)
         {
-            auto &tab = tabs.at(index);
-            for (auto &sound : tab.sounds)
+            for (const auto &sound : tab.sounds)
             {
-                Globals::gSounds->erase(sound.id);
-                if (sound.isFavorite)
+                auto it = previous.find(sound.id);
+                if (it == previous.end())
                 {
-                    Globals::gFavorites->erase(sound.id);
+                    registry->insert(sound);
+                    continue;
                 }
+
+                if (!isSame(*it->second, sound))
+                {
+                    registry->insert(sound);
+                }
+                previous.erase(it);
             }
+        }
 
+        for (const auto &[id, sound] : previous)
+        {
+            registry->erase(id);
+        }
+    }
+    //* The sounds of a tab only keep their order and are what ends up in the config, the registry knows their
+    //* current state
+    Tab Data::resolve(Tab tab) const
+    {
+        if (!registry)
+        {
+            return tab;
+        }
+
+        for (auto &sound : tab.sounds)
+        {
+            if (auto stored = registry->get(sound.id); stored)
+            {
+                sound = std::move(*stored);
+            }
+        }
+
+        return tab;
+    }
+
+    Tab Data::addTab(Tab tab)
+    {
+        tab.id = tabs.size();
+        tabs.emplace_back(tab);
+        reindex({}, {tab});
+
+        return tabs.back();
+    }
+    void Data::removeTabById(const std::uint32_t &index)
+    {
+        if (tabs.size() > index)
+        {
+            reindex({tabs.at(index)}, {});
             tabs.erase(tabs.begin() + index);
 
             for (std::size_t i = 0; tabs.size() > i; i++)
@@ -48,44 +127,42 @@ namespace Soundux::Objects
     }
     void Data::setTabs(const std::vector<Tab> &newTabs)
     {
+        auto previous = std::move(tabs);
         tabs = newTabs;
-        Globals::gSounds->clear();
-        Globals::gFavorites->clear();
         for (std::size_t i = 0; tabs.size() > i; i++)
         {
-            auto &tab = tabs.at(i);
-            tab.id = i;
-
-            for (auto &sound : tab.sounds)
-            {
-                Globals::gSounds->insert({sound.id, sound});
-                if (sound.isFavorite)
-                {
-                    Globals::gFavorites->insert({sound.id, sound});
-                }
-            }
+            tabs.at(i).id = i;
         }
+
+        reindex(previous, tabs);
     }
     std::vector<Tab> Data::getTabs() const
     {
-        return tabs;
+        std::vector<Tab> rtn;
+        rtn.reserve(tabs.size());
+
+        for (const auto &tab : tabs)
+        {
+            rtn.emplace_back(resolve(tab));
+        }
+
+        return rtn;
     }
     std::optional<Tab> Data::getTab(const std::uint32_t &id) const
     {
         if (tabs.size() > id)
         {
-            return tabs.at(id);
+            return resolve(tabs.at(id));
         }
 
         Fancy::fancy.logTime().warning() << "Tried to access non existent tab " << id << std::endl;
         return std::nullopt;
     }
-    std::optional<std::reference_wrapper<Sound>> Data::getSound(const std::uint32_t &id)
+    std::optional<Sound> Data::getSound(const std::uint32_t &id)
     {
-        auto scopedSounds = Globals::gSounds.scoped();
-        if (scopedSounds->find(id) != scopedSounds->end())
+        if (auto sound = registry ? registry->get(id) : std::nullopt; sound)
         {
-            return scopedSounds->at(id);
+            return sound;
         }
 
         Fancy::fancy.logTime().warning() << "Tried to access non existent sound " << id << std::endl;
@@ -96,26 +173,11 @@ namespace Soundux::Objects
         if (tabs.size() > id)
         {
             auto &realTab = tabs.at(id);
-
-            for (const auto &sound : realTab.sounds)
-            {
-                Globals::gSounds->erase(sound.id);
-                if (sound.isFavorite)
-                {
-                    Globals::gFavorites->erase(sound.id);
-                }
-            }
+            auto previous = std::move(realTab);
 
             realTab = tab;
+            reindex({previous}, {realTab});
 
-            for (auto &sound : realTab.sounds)
-            {
-                Globals::gSounds->insert({sound.id, sound});
-                if (sound.isFavorite)
-                {
-                    Globals::gFavorites->insert({sound.id, sound});
-                }
-            }
             return realTab;
         }
 
@@ -124,80 +186,38 @@ namespace Soundux::Objects
     }
     void Data::set(const Data &other)
     {
-        tabs = other.tabs;
+        auto previous = std::move(tabs);
+
+        tabs = other.getTabs();
         width = other.width;
         height = other.height;
         soundIdCounter = other.soundIdCounter;
 
-        Globals::gSounds->clear();
-        Globals::gFavorites->clear();
-
         for (std::size_t i = 0; tabs.size() > i; i++)
         {
-            auto &tab = tabs.at(i);
-            tab.id = i;
-
-            for (auto &sound : tab.sounds)
-            {
-                Globals::gSounds->insert({sound.id, sound});
-                if (sound.isFavorite)
-                {
-                    Globals::gFavorites->insert({sound.id, sound});
-                }
-            }
+            tabs.at(i).id = i;
         }
+
+        reindex(previous, tabs);
     }
     void Data::markFavorite(const std::uint32_t &id, bool favourite)
     {
-        auto sound = getSound(id);
-        if (sound)
+        if (!registry || !registry->setFavorite(id, favourite))
         {
-            sound->get().isFavorite = favourite;
-            if (favourite)
-            {
-                Globals::gFavorites->insert({id, sound->get()});
-            }
-            else
-            {
-                auto scopedFavorites = Globals::gFavorites.scoped();
-                if (scopedFavorites->find(id) != scopedFavorites->end())
-                {
-                    scopedFavorites->erase(id);
-                }
-            }
+            Fancy::fancy.logTime().warning() << "Tried to access non existent sound " << id << std::endl;
         }
     }
     std::vector<std::uint32_t> Data::getFavoriteIds()
     {
-        auto scopedFavorites = Globals::gFavorites.scoped();
-
-        std::vector<std::uint32_t> rtn;
-        rtn.reserve(scopedFavorites->size());
-
-        for (const auto &sound : *scopedFavorites)
-        {
-            rtn.emplace_back(sound.first);
-        }
-
-        return rtn;
+        return registry ? registry->getFavoriteIds() : std::vector<std::uint32_t>{};
     }
     std::vector<Sound> Data::getFavorites()
     {
-        auto scopedFavorites = Globals::gFavorites.scoped();
-
-        std::vector<Sound> rtn;
-        rtn.reserve(scopedFavorites->size());
-
-        for (const auto &sound : *scopedFavorites)
-        {
-            rtn.emplace_back(sound.second);
-        }
-
-        return rtn;
+        return registry ? registry->getFavorites() : std::vector<Sound>{};
     }
     bool Data::doesTabExist(const std::string &path)
     {
         auto it = std::find_if(tabs.begin(), tabs.end(), [&](const auto &tab) { return tab.path == path; });
         return it != tabs.end();
     }
-} // namespace Soundux::Objects
\ No newline at end of file
+} // namespace Soundux::Objects
@@ -13,18 +13,28 @@ namespace Soundux
 {
     namespace Objects
     {
+        class SoundRegistry;
+
         class Data
         {
             template <typename, typename> friend struct nlohmann::adl_serializer;
 
           private:
             std::vector<Tab> tabs;
+            //* Knows the current state of every sound, data without one like the copy in the config just holds tabs
+            SoundRegistry *registry = nullptr;
+
+          private:
+            void reindex(const std::vector<Tab> &, const std::vector<Tab> &);
+            Tab resolve(Tab) const;
 
           public:
             bool isOnFavorites = false;
             int width = 1280, height = 720;
             std::uint32_t soundIdCounter = 0;
 
+            void setRegistry(SoundRegistry *);
+
             std::vector<Tab> getTabs() const;
             void setTabs(const std::vector<Tab> &);
             bool doesTabExist(const std::string &);
@@ -34,7 +44,8 @@ namespace Soundux
             void removeTabById(const std::uint32_t &);
 
             std::optional<Tab> getTab(const std::uint32_t &) const;
-            std::optional<std::reference_wrapper<Sound>> getSound(const std::uint32_t &);
+            //* A copy of the sound, changes go through the registry
+            std::optional<Sound> getSound(const std::uint32_t &);
 
             std::vector<Sound> getFavorites();
             std::vector<std::uint32_t> getFavoriteIds();
@@ -1,5 +1,6 @@
 #pragma once
 #include <core/enums/enums.hpp>
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <vector>
@@ -10,6 +11,29 @@ namespace Soundux
     {
         struct AudioDevice;
 
+        struct LoopRegion
+        {
+            //* In frames of the sound file itself, they are converted to the rate of the output when played
+            std::uint64_t start = 0;
+            std::uint64_t end = 0;       //* Exclusive, 0 loops until the end of the sound
+            std::uint64_t crossfade = 0; //* The end of the region is blended into the frames before the start
+        };
+
+        struct Loudness
+        {
+            double integrated = -70.0; //* In LUFS, anything at or below -70 is treated as silence
+            double truePeak = 0.0;     //* In dBTP
+        };
+
+        struct Metadata
+        {
+            std::uint64_t frames = 0; //* In frames of the file
+            std::uint32_t sampleRate = 0;
+            std::uint32_t channels = 0;
+            std::string codec;
+            std::uint32_t bitrate = 0; //* In kbit/s, averaged over the whole file
+        };
+
         struct Sound
         {
             std::uint32_t id;
@@ -22,6 +46,15 @@ namespace Soundux
 
             std::optional<int> localVolume;
             std::optional<int> remoteVolume;
+
+            int priority = 0; //* Sounds with a lower priority are stolen first once all voices are in use
+
+            //* Used instead of the whole sound while repeating
+            std::optional<LoopRegion> loop;
+
+            //* Measured in the background, only valid as long as the modifiedDate doesn't change
+            std::optional<Loudness> loudness;
+            std::optional<Metadata> metadata;
         };
 
         struct Tab
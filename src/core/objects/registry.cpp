@@ -0,0 +1,217 @@
+#include "registry.hpp"
+#include <algorithm>
+
+namespace Soundux::Objects
+{
+    SoundRegistry::Slot &SoundRegistry::at(std::uint32_t slot)
+    {
+        return (*blocks[slot / blockSize])[slot % blockSize];
+    }
+    SoundRegistry::Slot *SoundRegistry::resolve(const SoundHandle &handle)
+    {
+        if (blocks.size() * blockSize > handle.slot)
+        {
+            auto &slot = at(handle.slot);
+            if (slot.used && slot.generation == handle.generation)
+            {
+                return &slot;
+            }
+        }
+
+        return nullptr;
+    }
+    std::size_t SoundRegistry::hash(std::uint32_t id) const
+    {
+        //* Ids are handed out in order, the multiplication spreads them over the whole index
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(id) * 0x9E3779B97F4A7C15ull) >> (64 - indexBits));
+    }
+    std::size_t SoundRegistry::locate(std::uint32_t id) const
+    {
+        const auto mask = index.size() - 1;
+        for (auto bucket = hash(id);; bucket = (bucket + 1) & mask)
+        {
+            if (!index[bucket].used || index[bucket].id == id)
+            {
+                return bucket;
+            }
+        }
+    }
+    void SoundRegistry::grow()
+    {
+        auto previous = std::move(index);
+        indexBits++;
+        index = std::vector<Bucket>(std::size_t(1) << indexBits);
+
+        for (const auto &bucket : previous)
+        {
+            if (bucket.used)
+            {
+                index[locate(bucket.id)] = bucket;
+            }
+        }
+    }
+    SoundHandle SoundRegistry::insert(const Sound &sound)
+    {
+        std::lock_guard lock(registryMutex);
+
+        auto bucket = locate(sound.id);
+        if (!index[bucket].used)
+        {
+            if ((count + 1) * 2 > index.size())
+            {
+                grow();
+                bucket = locate(sound.id);
+            }
+
+            if (freeSlots.empty())
+            {
+                const auto first = static_cast<std::uint32_t>(blocks.size() * blockSize);
+                blocks.emplace_back(std::make_unique<std::array<Slot, blockSize>>());
+                for (auto slot = first + blockSize; slot > first; slot--)
+                {
+                    freeSlots.emplace_back(slot - 1);
+                }
+            }
+
+            index[bucket] = {sound.id, freeSlots.back(), true};
+            freeSlots.pop_back();
+            count++;
+        }
+
+        auto &slot = at(index[bucket].slot);
+        slot.sound = sound;
+        slot.used = true;
+
+        if (sound.isFavorite)
+        {
+            favorites.emplace(sound.id);
+        }
+        else
+        {
+            favorites.erase(sound.id);
+        }
+
+        return {index[bucket].slot, slot.generation};
+    }
+    bool SoundRegistry::erase(std::uint32_t id)
+    {
+        std::lock_guard lock(registryMutex);
+
+        auto hole = locate(id);
+        if (!index[hole].used)
+        {
+            return false;
+        }
+
+        auto &slot = at(index[hole].slot);
+        slot.sound = {};
+        slot.used = false;
+        slot.generation++;
+
+        freeSlots.emplace_back(index[hole].slot);
+        favorites.erase(id);
+        count--;
+
+        //* Entries after the hole are shifted back instead of leaving a tombstone, as long as that doesn't move
+        //* them in front of their home bucket
+        const auto mask = index.size() - 1;
+        for (auto bucket = (hole + 1) & mask; index[bucket].used; bucket = (bucket + 1) & mask)
+        {
+            const auto home = hash(index[bucket].id);
+            if (((bucket - home) & mask) >= ((bucket - hole) & mask))
+            {
+                index[hole] = index[bucket];
+                hole = bucket;
+            }
+        }
+        index[hole].used = false;
+
+        return true;
+    }
+    void SoundRegistry::clear()
+    {
+        std::lock_guard lock(registryMutex);
+
+        //* The blocks are kept, so outstanding handles only fail their generation check
+        freeSlots.clear();
+        for (auto block = blocks.size(); block > 0; block--)
+        {
+            for (auto slot = blockSize; slot > 0; slot--)
+            {
+                auto &entry = (*blocks[block - 1])[slot - 1];
+                if (entry.used)
+                {
+                    entry.sound = {};
+                    entry.used = false;
+                    entry.generation++;
+                }
+                freeSlots.emplace_back(static_cast<std::uint32_t>((block - 1) * blockSize + slot - 1));
+            }
+        }
+
+        std::fill(index.begin(), index.end(), Bucket{});
+        favorites.clear();
+        count = 0;
+    }
+    std::optional<SoundHandle> SoundRegistry::find(std::uint32_t id) const
+    {
+        std::lock_guard lock(registryMutex);
+        if (auto bucket = locate(id); index[bucket].used)
+        {
+            const auto slot = index[bucket].slot;
+            return SoundHandle{slot, (*blocks[slot / blockSize])[slot % blockSize].generation};
+        }
+
+        return std::nullopt;
+    }
+    std::optional<Sound> SoundRegistry::get(std::uint32_t id) const
+    {
+        std::lock_guard lock(registryMutex);
+        if (auto bucket = locate(id); index[bucket].used)
+        {
+            const auto slot = index[bucket].slot;
+            return (*blocks[slot / blockSize])[slot % blockSize].sound;
+        }
+
+        return std::nullopt;
+    }
+    bool SoundRegistry::setFavorite(std::uint32_t id, bool favorite)
+    {
+        std::lock_guard lock(registryMutex);
+        if (auto bucket = locate(id); index[bucket].used)
+        {
+            at(index[bucket].slot).sound.isFavorite = favorite;
+            if (favorite)
+            {
+                favorites.emplace(id);
+            }
+            else
+            {
+                favorites.erase(id);
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+    std::vector<Sound> SoundRegistry::getFavorites()
+    {
+        std::lock_guard lock(registryMutex);
+
+        std::vector<Sound> rtn;
+        rtn.reserve(favorites.size());
+
+        for (const auto &id : favorites)
+        {
+            rtn.emplace_back(at(index[locate(id)].slot).sound);
+        }
+
+        return rtn;
+    }
+    std::vector<std::uint32_t> SoundRegistry::getFavoriteIds()
+    {
+        std::lock_guard lock(registryMutex);
+        return {favorites.begin(), favorites.end()};
+    }
+} // namespace Soundux::Objects
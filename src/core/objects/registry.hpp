@@ -0,0 +1,113 @@
+#pragma once
+#include "objects.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace Soundux
+{
+    namespace Objects
+    {
+        struct SoundHandle
+        {
+            std::uint32_t slot = 0;
+            std::uint32_t generation = 0; //* Slots start at generation 1, a default handle is never valid
+        };
+
+        //* Owns every known sound. Sounds are only handed out as copies and changed through modify, handles notice
+        //* when their slot was reused since.
+        class SoundRegistry
+        {
+            static constexpr std::size_t blockSize = 256;
+
+            struct Slot
+            {
+                Sound sound;
+                std::uint32_t generation = 1; //* Bumped whenever the sound is erased
+                bool used = false;
+            };
+            struct Bucket
+            {
+                std::uint32_t id = 0;
+                std::uint32_t slot = 0;
+                bool used = false;
+            };
+
+            std::vector<std::unique_ptr<std::array<Slot, blockSize>>> blocks;
+            std::vector<std::uint32_t> freeSlots;
+
+            //* Open addressing with linear probing, grown before it is half full
+            std::vector<Bucket> index = std::vector<Bucket>(64);
+            std::size_t count = 0;
+            std::uint32_t indexBits = 6;
+
+            std::set<std::uint32_t> favorites;
+            mutable std::mutex registryMutex;
+
+          private:
+            Slot &at(std::uint32_t);
+            Slot *resolve(const SoundHandle &);
+            std::size_t hash(std::uint32_t) const;
+            std::size_t locate(std::uint32_t) const;
+            void grow();
+
+          public:
+            //* Sounds that are already known are updated in place and keep their handle
+            SoundHandle insert(const Sound &);
+            bool erase(std::uint32_t);
+            void clear();
+
+            std::optional<SoundHandle> find(std::uint32_t) const;
+            std::optional<Sound> get(std::uint32_t) const;
+
+            bool setFavorite(std::uint32_t, bool);
+            std::vector<Sound> getFavorites();
+            std::vector<std::uint32_t> getFavoriteIds();
+
+            //* Runs the function on the sound while no one else can change it and returns the result
+            template <typename Function> std::optional<Sound> modify(std::uint32_t id, Function &&function)
+            {
+                std::lock_guard lock(registryMutex);
+                if (auto bucket = locate(id); index[bucket].used)
+                {
+                    auto &sound = at(index[bucket].slot).sound;
+                    function(sound);
+                    return sound;
+                }
+
+                return std::nullopt;
+            }
+            //* Same as above, but does nothing if the sound was erased since the handle was taken
+            template <typename Function> std::optional<Sound> modify(const SoundHandle &handle, Function &&function)
+            {
+                std::lock_guard lock(registryMutex);
+                if (auto *slot = resolve(handle); slot)
+                {
+                    function(slot->sound);
+                    return slot->sound;
+                }
+
+                return std::nullopt;
+            }
+            //* Visits every sound until the function returns true
+            template <typename Function> void forEach(Function &&function)
+            {
+                std::lock_guard lock(registryMutex);
+                for (const auto &block : blocks)
+                {
+                    for (auto &slot : *block)
+                    {
+                        if (slot.used && function(static_cast<const Sound &>(slot.sound)))
+                        {
+                            return;
+                        }
+                    }
+                }
+            }
+        };
+    } // namespace Objects
+} // namespace Soundux
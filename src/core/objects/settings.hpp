@@ -19,13 +19,46 @@ namespace Soundux
             std::vector<std::string> outputs;
             std::uint32_t selectedTab = 0;
 
+            std::uint32_t pcmCacheSize = 256;    //* In MiB
+            std::uint32_t streamThreshold = 16;  //* In MiB, bigger sounds are streamed from disk instead of cached
+            std::uint32_t pipeWireQuantum = 256; //* In frames, buffer size of the native PipeWire output
+
+            //* Performance profile of the playback devices, 0 lets the backend decide
+            std::uint32_t periodSize = 0; //* In frames
+            std::uint32_t periodCount = 0;
+            std::uint32_t sampleRate = 48000; //* Internal rate, only used when matchDeviceSampleRate is off
+            bool matchDeviceSampleRate = true;
+            bool exclusiveMode = false; //* Low-latency share mode, not every backend supports it
+            Enums::ResampleQuality resampleQuality = Enums::ResampleQuality::Sinc;
+
+            std::uint32_t maxVoices = 32;         //* Sounds that may play at once up to 64, playing more steals a voice
+            std::uint32_t fadeDuration = 5;       //* In ms, sounds fade in and out on start, stop, pause and seek
+            std::uint32_t progressInterval = 500; //* In ms, how often the ui is told about the playback positions
+            Enums::VoiceStealing voiceStealing = Enums::VoiceStealing::Oldest;
+
+            //* Keeps overlapping sounds from clipping, applied to the mixed output of every device
+            Enums::LimiterMode limiterMode = Enums::LimiterMode::Lookahead;
+            float limiterAttack = 2.f;    //* In ms, at most the lookahead of 5ms
+            float limiterRelease = 100.f; //* In ms
+            float limiterCeiling = -1.f;  //* In dBFS
+
             int remoteVolume = 100;
             int localVolume = 50;
             bool syncVolumes = false;
 
+            //* Sounds are brought to the target loudness once they have been analyzed
+            bool normalizeLoudness = false;
+            int loudnessTarget = -16; //* In LUFS
+
             bool allowMultipleOutputs = false;
             bool useAsDefaultDevice = false;
             bool muteDuringPlayback = false;
+
+            //* Mixes the microphone in-process and lowers it while sounds play, replaces muteDuringPlayback
+            bool duckMicrophone = false;
+            float duckAmount = 12.f;   //* In dB
+            float duckAttack = 10.f;   //* In ms
+            float duckRelease = 300.f; //* In ms
             bool allowOverlapping = true;
             bool minimizeToTray = false;
             bool tabHotkeysOnly = false;
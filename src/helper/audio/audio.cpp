@@ -1,6 +1,18 @@
 #include "audio.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
 #include <core/global/globals.hpp>
+#include <cstdlib>
 #include <fancy.hpp>
+#include <filesystem>
+#include <helper/audio/dsp/dsp.hpp>
+#if defined(__linux__)
+#include <cstring>
+#include <helper/audio/linux/pipewire/pipewire.hpp>
+#include <helper/audio/linux/pulseaudio/pulseaudio.hpp>
+#endif
 #if defined(_WIN32)
 #include <helper/misc/misc.hpp>
 #endif
@@ -14,166 +26,1748 @@ namespace Soundux::Objects
     using Soundux::Helpers::widen;
 #endif
 
+    namespace
+    {
+        bool isMp3(const std::string &path)
+        {
+            auto extension = std::filesystem::path(path).extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                           [](unsigned char c) { return std::tolower(c); });
+
+            return extension == ".mp3";
+        }
+    } // namespace
+
     void Audio::setup()
     {
+        stopAll();
+        closeOutputs();
+        setCacheSize(Globals::gSettings.pcmCacheSize);
+        setStreamThreshold(Globals::gSettings.streamThreshold);
+        cache.setResampleQuality(Globals::gSettings.resampleQuality);
+        Globals::gSettings.maxVoices = clampMaxVoices(Globals::gSettings.maxVoices);
+
+        //* There can never be more sounds than voices, so the pools can't run out either
+        if (decoderPool->empty())
+        {
+            for (std::size_t i = 0; Output::maxVoices > i; i++)
+            {
+                decoderPool->emplace_back(std::make_shared<DecoderSlot>());
+            }
+        }
+        if (soundPool.empty())
+        {
+            auto scoped = playingSounds.scoped();
+            for (std::size_t i = 0; maxSounds > i; i++)
+            {
+                soundPool.emplace_back(std::make_shared<PlayingSound>());
+            }
+        }
+
+        //* Every output runs at the same rate, that way sounds are only resampled once when they are loaded
+        //* and never while mixing. When matching the device rate, the default device picks it.
+        sampleRate = Globals::gSettings.matchDeviceSampleRate ? 0 : Globals::gSettings.sampleRate;
+
 #if defined(__linux__)
         nullSink = std::nullopt;
+        std::optional<AudioDevice> sink;
 #endif
-        for (const auto &device : getAudioDevices())
+        for (const auto &device : refreshDevices())
         {
             if (device.isDefault)
             {
+                auto scoped = outputs.scoped();
                 defaultPlayback = device;
             }
 #if defined(__linux__)
             if (device.name == "soundux_sink")
             {
-                nullSink = device;
+                sink = device;
+            }
+#endif
+        }
+
+        //* The outputs are opened once and kept running, playing a sound only adds a voice to them.
+        {
+            auto scoped = outputs.scoped();
+            if (auto *output = getOutput(defaultPlayback); output && !sampleRate)
+            {
+                sampleRate = output->sampleRate;
             }
+        }
+        if (!sampleRate)
+        {
+            sampleRate = Globals::gSettings.sampleRate;
+        }
+
+#if defined(__linux__)
+        //* Prefer rendering straight into the native PipeWire stream over going through the null sink
+        nullSink = openStreamOutput();
+        if (!nullSink && sink)
+        {
+            nullSink = sink;
+            getOutput(*nullSink);
+        }
 #endif
+
+#if defined(__linux__)
+        updateDucking();
+#endif
+
+        if (!running)
+        {
+            running = true;
+            dispatcher = std::thread([this] { dispatch(); });
+            streamer = std::thread([this] { stream(); });
+
+            //* Callback statistics are only logged on request, the diagnostics are always available to the frontend
+            if (std::getenv("SOUNDUX_DEBUG"))
+            {
+                diagnosticsTimer = Globals::gQueue.push_every(Queue::taskId(Queue::TaskType::LogDiagnostics),
+                                                              std::chrono::seconds(10), [this] { logDiagnostics(); });
+            }
         }
     }
     void Audio::destroy()
     {
+        running = false;
+        if (dispatcher.joinable())
+        {
+            dispatcher.join();
+        }
+        if (streamer.joinable())
+        {
+            streamer.join();
+        }
+        if (diagnosticsTimer)
+        {
+            *diagnosticsTimer = true;
+            diagnosticsTimer.reset();
+        }
+
         stopAll();
+        closeOutputs();
+        recycleDecoders();
+        cache.clear();
+
+        if (hasContext)
+        {
+            devices.scoped()->clear();
+            ma_context_uninit(&context);
+            hasContext = false;
+        }
     }
-    std::optional<PlayingSound> Audio::play(const Objects::Sound &sound,
-                                            const std::optional<Objects::AudioDevice> &playbackDevice)
+    std::uint32_t Audio::clampMaxVoices(std::uint32_t maxVoices)
     {
-        static std::atomic<std::uint64_t> id = 0;
+        auto clamped = std::clamp<std::uint32_t>(maxVoices, 1, maxSounds);
+        if (clamped != maxVoices)
+        {
+            Fancy::fancy.logTime().warning() << "Max voices of " << maxVoices << " is out of range, using " << clamped
+                                             << " instead" << std::endl;
+        }
 
-        auto *decoder = new ma_decoder;
-#if defined(_WIN32)
-        auto res = ma_decoder_init_file_w(widen(sound.path).c_str(), nullptr, decoder);
-#else
-        auto res = ma_decoder_init_file(sound.path.c_str(), nullptr, decoder);
-#endif
+        return clamped;
+    }
+    void Audio::setCacheSize(std::uint32_t size)
+    {
+        cache.setBudget(static_cast<std::size_t>(size) * 1024 * 1024);
+    }
+    void Audio::setStreamThreshold(std::uint32_t size)
+    {
+        cache.setMaxEntrySize(static_cast<std::size_t>(size) * 1024 * 1024);
+    }
+    std::uint64_t Audio::getUnderruns()
+    {
+        std::uint64_t rtn = 0;
 
-        if (res != MA_SUCCESS)
+        auto scoped = outputs.scoped();
+        for (const auto &[name, output] : *scoped)
         {
-            Fancy::fancy.logTime().failure() << "Failed to create decoder from file: " << sound.path << ", error: " >>
-                res << std::endl;
-            delete decoder;
+            rtn += output->underruns;
+        }
 
-            return std::nullopt;
+        return rtn;
+    }
+    std::vector<OutputInfo> Audio::getOutputInfo()
+    {
+        std::vector<OutputInfo> rtn;
+
+        auto scoped = outputs.scoped();
+        for (const auto &[name, output] : *scoped)
+        {
+            OutputInfo info;
+            info.name = name;
+            info.sampleRate = output->sampleRate;
+            info.periodSize = output->periodSize;
+            info.periods = output->periods;
+            info.exclusive = output->exclusive;
+            info.latency = output->latency;
+            info.gainReduction = output->gainReduction.exchange(0.f);
+            info.limitedPeriods = output->limitedPeriods;
+
+            info.callbacks = output->callbacks;
+            info.callbackTime = info.callbacks ? static_cast<double>(output->callbackTime) / 1000.0 /
+                                                     static_cast<double>(info.callbacks)
+                                               : 0.0;
+
+            rtn.emplace_back(info);
         }
 
-        auto *device = new ma_device;
-        auto config = ma_device_config_init(ma_device_type_playback);
-        auto length_in_pcm_frames = ma_decoder_get_length_in_pcm_frames(decoder);
+        return rtn;
+    }
+    std::vector<OutputDiagnostics> Audio::getDiagnostics()
+    {
+        std::vector<OutputDiagnostics> rtn;
 
-        config.dataCallback = data_callback;
-        config.sampleRate = decoder->outputSampleRate;
-        config.playback.format = decoder->outputFormat;
-        config.playback.channels = decoder->outputChannels;
+        auto scoped = outputs.scoped();
+        for (const auto &[name, output] : *scoped)
+        {
+            OutputDiagnostics diagnostics;
+            diagnostics.name = name;
+            diagnostics.callbacks = output->callbacks.load(std::memory_order_relaxed);
+            diagnostics.underruns = output->underruns;
+            diagnostics.deadlineMisses = output->deadlineMisses.load(std::memory_order_relaxed);
+            diagnostics.framesRequested = output->framesRequested.load(std::memory_order_relaxed);
+            diagnostics.framesStarved = output->framesStarved.load(std::memory_order_relaxed);
+
+            diagnostics.deadline = static_cast<double>(output->deadline.load(std::memory_order_relaxed)) / 1000.0;
+            diagnostics.worstCallback =
+                static_cast<double>(output->worstCallback.load(std::memory_order_relaxed)) / 1000.0;
+            diagnostics.averageCallback =
+                diagnostics.callbacks ? static_cast<double>(output->callbackTime.load(std::memory_order_relaxed)) /
+                                            1000.0 / static_cast<double>(diagnostics.callbacks)
+                                      : 0.0;
+
+            diagnostics.histogramStart = Output::histogramStart;
+            for (const auto &bucket : output->histogram)
+            {
+                diagnostics.histogram.emplace_back(bucket.load(std::memory_order_relaxed));
+            }
 
-        auto pSound = std::make_shared<PlayingSound>();
-        config.pUserData = reinterpret_cast<void *>(static_cast<PlayingSound *>(pSound.get()));
+            rtn.emplace_back(diagnostics);
+        }
 
-        if (playbackDevice)
+        return rtn;
+    }
+    void Audio::logDiagnostics()
+    {
+        for (const auto &diagnostics : getDiagnostics())
         {
-            config.playback.pDeviceID = &playbackDevice->raw.id;
+            Fancy::fancy.logTime().message()
+                << "Output " << diagnostics.name << ": " << diagnostics.callbacks << " callback(s), "
+                << diagnostics.averageCallback << "us average, " << diagnostics.worstCallback << "us worst of "
+                << diagnostics.deadline << "us, " << diagnostics.deadlineMisses << " deadline miss(es), "
+                << diagnostics.underruns << " underrun(s), " << diagnostics.framesStarved << "/"
+                << diagnostics.framesRequested << " frame(s) starved" << std::endl;
         }
-        else
+
+        for (const auto &[lane, name] : {std::make_pair(Queue::Lane::Control, "control"),
+                                         std::make_pair(Queue::Lane::Background, "background")})
         {
-            config.playback.pDeviceID = &defaultPlayback.raw.id;
+            auto stats = Globals::gQueue.getStats(lane);
+            Fancy::fancy.logTime().message()
+                << "Queue " << name << ": " << stats.pending << " pending, " << stats.completed << " completed, "
+                << stats.averageWait << "us average wait, " << stats.worstWait << "us worst wait, "
+                << stats.averageRun << "us average run, " << stats.rejected << " rejected" << std::endl;
         }
+    }
+    std::int64_t Audio::getAudibleAt()
+    {
+        std::int64_t rtn = 0;
 
-        if (ma_device_init(nullptr, &config, device) != MA_SUCCESS)
+        auto scoped = outputs.scoped();
+        for (const auto &[name, output] : *scoped)
         {
-            Fancy::fancy.logTime().failure() << "Failed to create device" << std::endl;
-            ma_decoder_uninit(decoder);
-            delete decoder;
-            delete device;
+            rtn = std::max(rtn, output->audibleAt.load(std::memory_order_relaxed));
+        }
 
-            return std::nullopt;
+        return rtn;
+    }
+    void Audio::useNullBackend()
+    {
+        nullBackend = true;
+    }
+    void Audio::setFadeDuration(std::uint32_t duration)
+    {
+        auto scoped = outputs.scoped();
+        for (auto &[name, output] : *scoped)
+        {
+            output->fadeMs = duration;
+        }
+    }
+    void Audio::updateLimiter()
+    {
+        const auto &settings = Globals::gSettings;
+
+        auto scoped = outputs.scoped();
+        for (auto &[name, output] : *scoped)
+        {
+            output->limiter.setParameters(settings.limiterMode, settings.limiterAttack, settings.limiterRelease,
+                                          settings.limiterCeiling);
+        }
+    }
+    void Audio::preload(const std::vector<Sound> &sounds)
+    {
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> formats;
+        {
+            auto scoped = outputs.scoped();
+            for (const auto &[name, output] : *scoped)
+            {
+                auto format = std::make_pair(output->channels, output->sampleRate);
+                if (std::find(formats.begin(), formats.end(), format) == formats.end())
+                {
+                    formats.emplace_back(format);
+                }
+            }
         }
 
-        if (playbackDevice)
+        std::size_t rejected = 0;
+        for (const auto &sound : sounds)
         {
-            if (sound.remoteVolume)
+            //* Sounds that are too big are streamed anyway, there is no point in decoding them in the background
+            if (std::none_of(formats.begin(), formats.end(), [&](const auto &format) {
+                    return cache.fits(sound, format.first, format.second);
+                }))
             {
-                device->masterVolumeFactor = static_cast<float>(*sound.remoteVolume) / 100.f;
+                continue;
             }
-            else
+
+            auto result = Globals::gQueue.push_unique(
+                Queue::taskId(Queue::TaskType::Preload, sound.id), [this, sound, formats] {
+                    for (const auto &[channels, sampleRate] : formats)
+                    {
+                        cache.load(sound, channels, sampleRate);
+                    }
+                });
+
+            if (result == Queue::Result::Full)
             {
-                device->masterVolumeFactor = static_cast<float>(Globals::gSettings.remoteVolume) / 100.f;
+                rejected++;
             }
         }
-        else
+
+        if (rejected > 0)
+        {
+            Fancy::fancy.logTime().warning()
+                << "Background queue is full, " << rejected << " sound(s) will not be preloaded" << std::endl;
+        }
+    }
+    void Audio::analyze(const std::vector<Sound> &sounds)
+    {
+        //* The results are dropped if the sound changed or was removed in the meantime, the handle catches removals
+        //* even if the id was handed out again
+        auto store = [](const SoundHandle &handle, const Sound &sound, const std::function<void(Sound &)> &apply) {
+            Globals::gSounds.modify(handle, [&](Sound &stored) {
+                if (stored.path == sound.path && stored.modifiedDate == sound.modifiedDate)
+                {
+                    apply(stored);
+                }
+            });
+        };
+
+        std::size_t rejected = 0;
+        for (const auto &sound : sounds)
         {
-            if (sound.localVolume)
+            auto found = Globals::gSounds.find(sound.id);
+            if (!found)
             {
-                device->masterVolumeFactor = static_cast<float>(*sound.localVolume) / 100.f;
+                continue;
             }
-            else
+
+            //* The metadata is cheap to probe and shown in the tab listing, so it comes before any loudness
+            if (!sound.metadata)
+            {
+                auto result = Globals::gQueue.push_unique(
+                    Queue::taskId(Queue::TaskType::ProbeMetadata, sound.id), [this, handle = *found, sound, store] {
+                        if (auto metadata = probe(sound); metadata)
+                        {
+                            store(handle, sound, [&](Sound &stored) { stored.metadata = metadata; });
+                        }
+                    });
+
+                if (result == Queue::Result::Full)
+                {
+                    rejected++;
+                }
+            }
+            if (!sound.loudness)
             {
-                device->masterVolumeFactor = static_cast<float>(Globals::gSettings.localVolume) / 100.f;
+                //* Queued after preloads and seek tables, which are needed sooner
+                auto result = Globals::gQueue.push_unique(
+                    Queue::taskId(Queue::TaskType::MeasureLoudness, sound.id), [this, handle = *found, sound, store] {
+                        if (auto loudness = measureLoudness(sound); loudness)
+                        {
+                            store(handle, sound, [&](Sound &stored) { stored.loudness = loudness; });
+                        }
+                    });
+
+                if (result == Queue::Result::Full)
+                {
+                    rejected++;
+                }
             }
         }
 
-        if (ma_device_start(device) != MA_SUCCESS)
+        if (rejected > 0)
+        {
+            Fancy::fancy.logTime().warning()
+                << "Background queue is full, " << rejected << " analysis task(s) were dropped" << std::endl;
+        }
+    }
+    std::optional<Metadata> Audio::probe(const Sound &sound)
+    {
+        ma_decoder decoder;
+        auto config = ma_decoder_config_init(ma_format_f32, 0, 0);
+#if defined(_WIN32)
+        auto res = ma_decoder_init_file_w(widen(sound.path).c_str(), &config, &decoder);
+#else
+        auto res = ma_decoder_init_file(sound.path.c_str(), &config, &decoder);
+#endif
+        if (res != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().warning() << "Failed to probe " << sound.path << ", error: " >> res << std::endl;
+            return std::nullopt;
+        }
+
+        //* This is the expensive part for mp3, which has to be scanned from start to end
+        Metadata metadata;
+        metadata.frames = ma_decoder_get_length_in_pcm_frames(&decoder);
+        metadata.sampleRate = decoder.internalSampleRate;
+        metadata.channels = decoder.internalChannels;
+        ma_decoder_uninit(&decoder);
+
+        //* miniaudio picks the decoder by the extension as well
+        auto extension = std::filesystem::path(sound.path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        metadata.codec = extension.empty() ? "unknown" : extension.substr(1);
+
+        metadata.bitrate = 0;
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(sound.path, ec);
+        if (!ec && metadata.frames && metadata.sampleRate)
+        {
+            const auto seconds = static_cast<double>(metadata.frames) / metadata.sampleRate;
+            metadata.bitrate = static_cast<std::uint32_t>(static_cast<double>(size) * 8 / seconds / 1000);
+        }
+
+        return metadata;
+    }
+    std::optional<Loudness> Audio::measureLoudness(const Sound &sound)
+    {
+        //* Measured at the rate and channel count of the file, that is what the loudness is defined on
+        ma_decoder decoder;
+        auto config = ma_decoder_config_init(ma_format_f32, 0, 0);
+#if defined(_WIN32)
+        auto res = ma_decoder_init_file_w(widen(sound.path).c_str(), &config, &decoder);
+#else
+        auto res = ma_decoder_init_file(sound.path.c_str(), &config, &decoder);
+#endif
+        if (res != MA_SUCCESS)
         {
-            ma_device_uninit(device);
-            ma_decoder_uninit(decoder);
+            Fancy::fancy.logTime().warning() << "Failed to analyze " << sound.path << ", error: " >> res << std::endl;
+            return std::nullopt;
+        }
+
+        Helpers::LoudnessMeter meter(decoder.outputChannels, decoder.outputSampleRate);
+        std::vector<float> buffer(static_cast<std::size_t>(Output::streamChunkFrames) * decoder.outputChannels);
 
-            delete device;
-            delete decoder;
+        while (running)
+        {
+            const auto read = ma_decoder_read_pcm_frames(&decoder, buffer.data(), Output::streamChunkFrames);
+            meter.process(buffer.data(), static_cast<std::size_t>(read));
 
-            Fancy::fancy.logTime().warning() << "Failed to play sound " << sound.path << std::endl;
+            if (read < Output::streamChunkFrames)
+            {
+                break;
+            }
+        }
+        ma_decoder_uninit(&decoder);
 
+        if (!running)
+        {
             return std::nullopt;
         }
 
-        auto soundId = ++id;
+        //* Silence is stored at the gate, json has no representation for infinity
+        constexpr auto silence = -70.0;
 
-        pSound->id = soundId;
-        pSound->sound = sound;
-        pSound->raw.device = device;
-        pSound->raw.decoder = decoder;
-        pSound->length = length_in_pcm_frames;
-        pSound->sampleRate = config.sampleRate;
-        pSound->playbackDevice = playbackDevice ? *playbackDevice : defaultPlayback;
-        pSound->lengthInMs = static_cast<std::uint64_t>(static_cast<double>(pSound->length) /
-                                                        static_cast<double>(config.sampleRate) * 1000);
+        Loudness loudness;
+        loudness.integrated = std::max(meter.getIntegrated(), silence);
+        loudness.truePeak = std::max(meter.getTruePeak(), silence);
 
-        playingSounds->emplace(soundId, pSound);
-        return *pSound;
+        return loudness;
     }
-    void Audio::stopAll()
+    float Audio::getNormalization(const Sound &sound)
     {
-        auto scoped = playingSounds.scoped();
-        while (!scoped->empty())
+        const auto &settings = Globals::gSettings;
+        if (!settings.normalizeLoudness || !sound.loudness || sound.loudness->integrated <= -70.0)
+        {
+            return 1.f;
+        }
+
+        //* Boosting quiet sounds is limited by their true peak, they must not clip
+        constexpr auto ceiling = -1.0; //* In dBTP
+
+        auto gain = static_cast<double>(settings.loudnessTarget) - sound.loudness->integrated;
+        gain = std::min(gain, ceiling - sound.loudness->truePeak);
+
+        return static_cast<float>(std::pow(10.0, gain / 20.0));
+    }
+    Output *Audio::getOutput(const AudioDevice &playbackDevice)
+    {
+        auto scoped = outputs.scoped();
+        if (scoped->find(playbackDevice.name) != scoped->end())
+        {
+            return scoped->at(playbackDevice.name).get();
+        }
+
+        const auto &settings = Globals::gSettings;
+
+        auto output = std::make_unique<Output>();
+        output->playbackDevice = playbackDevice;
+        output->fadeMs = settings.fadeDuration;
+        output->limiter.setParameters(settings.limiterMode, settings.limiterAttack, settings.limiterRelease,
+                                      settings.limiterCeiling);
+
+        auto config = ma_device_config_init(ma_device_type_playback);
+        config.dataCallback = data_callback;
+        config.playback.channels = 2;
+        config.playback.format = ma_format_f32;
+        config.playback.pDeviceID = &output->playbackDevice.raw.id;
+        config.playback.shareMode = settings.exclusiveMode ? ma_share_mode_exclusive : ma_share_mode_shared;
+        config.performanceProfile = ma_performance_profile_low_latency;
+        config.periodSizeInFrames = settings.periodSize;
+        config.periods = settings.periodCount;
+        config.sampleRate = sampleRate;
+        config.pUserData = reinterpret_cast<void *>(output.get());
+
+        auto result = ma_device_init(hasContext ? &context : nullptr, &config, &output->device);
+        if (result != MA_SUCCESS && config.playback.shareMode == ma_share_mode_exclusive)
+        {
+            Fancy::fancy.logTime().warning() << "Device " << playbackDevice.name
+                                             << " can't be opened in exclusive mode, falling back to shared mode"
+                                             << std::endl;
+
+            config.playback.shareMode = ma_share_mode_shared;
+            result = ma_device_init(hasContext ? &context : nullptr, &config, &output->device);
+        }
+        if (result != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to create device " << playbackDevice.name << std::endl;
+            return nullptr;
+        }
+        if (ma_device_start(&output->device) != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to start device " << playbackDevice.name << std::endl;
+            ma_device_uninit(&output->device);
+            return nullptr;
+        }
+
+        output->channels = output->device.playback.channels;
+        output->sampleRate = output->device.sampleRate;
+        output->periodSize = output->device.playback.internalPeriodSizeInFrames;
+        output->periods = output->device.playback.internalPeriods;
+        output->exclusive = config.playback.shareMode == ma_share_mode_exclusive;
+        output->latency = static_cast<double>(output->periodSize) * output->periods /
+                          output->device.playback.internalSampleRate * 1000;
+
+        Fancy::fancy.logTime().message() << "Opened " << playbackDevice.name << " with " << output->periods
+                                         << " period(s) of " << output->periodSize << " frames (" << output->latency
+                                         << "ms)" << std::endl;
+
+        auto *rtn = output.get();
+        scoped->emplace(playbackDevice.name, std::move(output));
+
+        return rtn;
+    }
+#if defined(__linux__)
+    std::optional<AudioDevice> Audio::openStreamOutput()
+    {
+        auto pipeWire = std::dynamic_pointer_cast<PipeWire>(Globals::gAudioBackend);
+        if (!pipeWire || !pipeWire->setStreamRate(sampleRate))
+        {
+            return std::nullopt;
+        }
+
+        auto output = std::make_unique<Output>();
+        output->playbackDevice.raw = {};
+        output->playbackDevice.name = "soundux_playback";
+        output->playbackDevice.isDefault = false;
+        output->sampleRate = pipeWire->getStreamRate();
+        output->periodSize = Globals::gSettings.pipeWireQuantum;
+        output->periods = 1;
+        output->latency = static_cast<double>(output->periodSize) / output->sampleRate * 1000;
+        output->close = [pipeWire] { pipeWire->setRenderer(nullptr, nullptr); };
+
+        const auto &settings = Globals::gSettings;
+        output->fadeMs = settings.fadeDuration;
+        output->limiter.setParameters(settings.limiterMode, settings.limiterAttack, settings.limiterRelease,
+                                      settings.limiterCeiling);
+
+        pipeWire->setRenderer(
+            [](void *data, float *buffer, std::uint32_t frames) {
+                render(reinterpret_cast<Output *>(data), buffer, frames);
+            },
+            output.get());
+
+        auto device = output->playbackDevice;
+        outputs->emplace(device.name, std::move(output));
+
+        return device;
+    }
+    void Audio::setStreamQuantum(std::uint32_t quantum)
+    {
+        auto pipeWire = std::dynamic_pointer_cast<PipeWire>(Globals::gAudioBackend);
+        if (!pipeWire)
+        {
+            return;
+        }
+
+        pipeWire->setQuantum(quantum);
+
+        auto scoped = outputs.scoped();
+        for (auto &[name, output] : *scoped)
+        {
+            if (output->close)
+            {
+                output->periodSize = quantum;
+                output->latency = static_cast<double>(quantum) / output->sampleRate * 1000;
+            }
+        }
+    }
+    void Audio::updateDucking()
+    {
+        const auto &settings = Globals::gSettings;
+        auto pulse = std::dynamic_pointer_cast<PulseAudio>(Globals::gAudioBackend);
+
+        //* Only PulseAudio routes the microphone through our sink, on PipeWire apps record it directly
+        if (!settings.duckMicrophone || !pulse || !nullSink)
+        {
+            closeMicrophone();
+            return;
+        }
+
+        auto *output = getOutput(*nullSink);
+        if (!output)
+        {
+            return;
+        }
+
+        output->ducker.setParameters(settings.duckAmount, settings.duckAttack, settings.duckRelease);
+        if (microphone)
+        {
+            return;
+        }
+
+        output->input.resize(static_cast<std::size_t>(output->sampleRate / 5) * output->channels);
+
+        //* The original default source, the current one may already be our own sink
+        ma_device_id source{};
+        std::strncpy(source.pulse, pulse->getDefaultSource().c_str(), sizeof(source.pulse) - 1);
+
+        auto config = ma_device_config_init(ma_device_type_capture);
+        config.dataCallback = capture_callback;
+        config.capture.format = ma_format_f32;
+        config.capture.channels = output->channels;
+        config.capture.pDeviceID = &source;
+        config.sampleRate = output->sampleRate;
+        config.performanceProfile = ma_performance_profile_low_latency;
+        config.pUserData = reinterpret_cast<void *>(output);
+
+        auto device = std::make_unique<ma_device>();
+        auto result = ma_device_init(hasContext ? &context : nullptr, &config, device.get());
+        if (result != MA_SUCCESS)
+        {
+            config.capture.pDeviceID = nullptr;
+            result = ma_device_init(hasContext ? &context : nullptr, &config, device.get());
+        }
+        if (result != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to open microphone for ducking" << std::endl;
+            return;
+        }
+        if (ma_device_start(device.get()) != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to start microphone for ducking" << std::endl;
+            ma_device_uninit(device.get());
+            return;
+        }
+
+        //* From now on the microphone reaches the sink through us, the loopback would double it
+        if (!pulse->muteInput(true))
+        {
+            ma_device_uninit(device.get());
+            return;
+        }
+
+        microphone = std::move(device);
+        output->inputActive = true;
+    }
+    bool Audio::isDucking()
+    {
+        return microphone != nullptr;
+    }
+    void Audio::closeMicrophone()
+    {
+        if (!microphone)
+        {
+            return;
+        }
+
+        ma_device_uninit(microphone.get());
+        microphone.reset();
+
+        if (nullSink)
         {
-            auto &sound = scoped->begin()->second;
-            if (sound->raw.device && sound->raw.decoder)
+            auto scoped = outputs.scoped();
+            if (auto it = scoped->find(nullSink->name); it != scoped->end())
             {
-                ma_device_uninit(sound->raw.device);
-                ma_decoder_uninit(sound->raw.decoder);
+                it->second->inputActive = false;
             }
+        }
 
-            sound->raw.device = nullptr;
-            sound->raw.decoder = nullptr;
+        if (Globals::gAudioBackend)
+        {
+            Globals::gAudioBackend->muteInput(false);
+        }
+    }
+#endif
+    void Audio::closeOutput(const std::string &name)
+    {
+        auto scoped = outputs.scoped();
+        auto it = scoped->find(name);
+        if (it == scoped->end())
+        {
+            return;
+        }
+
+        auto *output = it->second.get();
+        if (output->close)
+        {
+            output->close();
+        }
+        else
+        {
+            ma_device_uninit(&output->device);
+        }
+
+        //* The device is stopped, so its voices will never report back and have to be dropped here
+        auto scopedVoices = voices.scoped();
+        for (auto group = scopedVoices->begin(); group != scopedVoices->end();)
+        {
+            auto &handles = group->second.voices;
+            handles.erase(std::remove_if(handles.begin(), handles.end(),
+                                         [&](const VoiceHandle &handle) { return handle.output == output; }),
+                          handles.end());
+
+            group = handles.empty() ? scopedVoices->erase(group) : std::next(group);
+        }
+
+        scoped->erase(it);
+    }
+    void Audio::switchDefaultPlayback(const AudioDevice &device)
+    {
+        //* Voices can't move to another device, so the sounds that play on the old one are stopped
+        std::vector<std::uint32_t> affected;
+        {
+            auto scoped = outputs.scoped();
+            auto scopedVoices = voices.scoped();
+            if (auto it = scoped->find(defaultPlayback.name); it != scoped->end())
+            {
+                for (const auto &[id, group] : *scopedVoices)
+                {
+                    if (std::any_of(group.voices.begin(), group.voices.end(),
+                                    [&](const VoiceHandle &handle) { return handle.output == it->second.get(); }))
+                    {
+                        affected.emplace_back(id);
+                    }
+                }
+            }
+        }
+
+        for (const auto &id : affected)
+        {
+            {
+                auto scoped = playingSounds.scoped();
+                if (auto it = scoped->find(id); it != scoped->end() && Globals::gGui)
+                {
+                    Globals::gGui->onSoundFinished(*it->second);
+                }
+            }
+            stop(id);
+        }
+
+        //* Closed and replaced under one lock, so play() can't reopen the old device in between
+        auto scoped = outputs.scoped();
+
+        bool keep = false;
+#if defined(__linux__)
+        //* The null sink keeps feeding the remote output, even if it was made the default
+        keep = nullSink && nullSink->name == defaultPlayback.name;
+#endif
+        if (!keep)
+        {
+            closeOutput(defaultPlayback.name);
+        }
+
+        defaultPlayback = device;
+        if (!getOutput(defaultPlayback))
+        {
+            Fancy::fancy.logTime().failure() << "Failed to open new default device " << device.name << std::endl;
+        }
+    }
+    AudioDevice Audio::getDefaultPlayback()
+    {
+        auto scoped = outputs.scoped();
+        return defaultPlayback;
+    }
+    void Audio::closeOutputs()
+    {
+#if defined(__linux__)
+        closeMicrophone();
+#endif
+
+        auto scoped = outputs.scoped();
+        for (auto &[name, output] : *scoped)
+        {
+            if (output->close)
+            {
+                output->close();
+            }
+            else
+            {
+                ma_device_uninit(&output->device);
+            }
+        }
+
+        //* The devices are stopped, so nothing references the voices anymore
+        voices->clear();
+        scoped->clear();
+    }
+    bool Audio::send(const Command &command, std::optional<bool> remote)
+    {
+        auto scoped = outputs.scoped();
+        auto scopedVoices = voices.scoped();
+
+        if (scopedVoices->find(command.id) == scopedVoices->end())
+        {
+            return false;
+        }
+
+        bool sent = false;
+        for (const auto &voice : scopedVoices->at(command.id).voices)
+        {
+            if (remote && voice.remote != *remote)
+            {
+                continue;
+            }
+
+            auto copy = command;
+            copy.slot = voice.slot;
+
+            if (send(voice.output, copy))
+            {
+                sent = true;
+            }
+        }
+
+        return sent;
+    }
+    bool Audio::send(Output *output, const Command &command)
+    {
+        std::lock_guard lock(output->commandMutex);
+        if (!output->commands.push(command))
+        {
+            Fancy::fancy.logTime().warning() << "Command queue of " << output->playbackDevice.name << " is full"
+                                             << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+    std::optional<std::size_t> Audio::acquireVoice(Output *output)
+    {
+        auto scoped = outputs.scoped();
+        for (std::size_t i = 0; output->voices.size() > i; i++)
+        {
+            auto &voice = output->voices[i];
+            if (!voice.used)
+            {
+                voice.reset();
+                voice.used = true;
+
+                return i;
+            }
+        }
+
+        return std::nullopt;
+    }
+    void Audio::releaseVoice(Output *output, std::size_t slot)
+    {
+        auto scoped = outputs.scoped();
+
+        auto &voice = output->voices[slot];
+        voice.reset();
+        voice.used = false;
+    }
+    std::shared_ptr<DecoderSlot> Audio::createDecoder(const Sound &sound, std::uint32_t channels,
+                                                      std::uint32_t sampleRate)
+    {
+        auto pool = decoderPool.scoped();
+        auto free = std::find_if(pool->begin(), pool->end(), [](const auto &slot) { return slot.use_count() == 1; });
+
+        if (free == pool->end())
+        {
+            Fancy::fancy.logTime().warning() << "Failed to create decoder for " << sound.path
+                                             << ", all decoders are in use" << std::endl;
+            return nullptr;
+        }
+
+        auto &slot = *free;
+        if (slot->initialized)
+        {
+            ma_decoder_uninit(&slot->decoder);
+            slot->initialized = false;
+        }
+
+        auto decoderConfig = ma_decoder_config_init(ma_format_f32, channels, sampleRate);
+        if (Globals::gSettings.resampleQuality == Enums::ResampleQuality::Sinc)
+        {
+            //* Streamed sounds are resampled by the decode worker, give its filter the highest order we can
+            decoderConfig.resampling.linear.lpfOrder = MA_MAX_FILTER_ORDER;
+        }
+        slot->seekTable = nullptr;
+
+        //* Mp3 files are opened as such explicitly, we rely on that when binding their seek table
+        auto res = MA_ERROR;
+        const bool mp3 = isMp3(sound.path);
+        if (mp3)
+        {
+#if defined(_WIN32)
+            res = ma_decoder_init_file_mp3_w(widen(sound.path).c_str(), &decoderConfig, &slot->decoder);
+#else
+            res = ma_decoder_init_file_mp3(sound.path.c_str(), &decoderConfig, &slot->decoder);
+#endif
+        }
+        if (res != MA_SUCCESS)
+        {
+#if defined(_WIN32)
+            res = ma_decoder_init_file_w(widen(sound.path).c_str(), &decoderConfig, &slot->decoder);
+#else
+            res = ma_decoder_init_file(sound.path.c_str(), &decoderConfig, &slot->decoder);
+#endif
+        }
+        else
+        {
+            bindSeekTable(sound, *slot);
+        }
+
+        if (res != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to create decoder from file: " << sound.path << ", error: " >>
+                res << std::endl;
+            return nullptr;
+        }
+        slot->initialized = true;
+        slot->seekRequest = 0;
+        slot->frame = 0;
+        slot->loopStart = 0;
+        slot->loopEnd = 0;
+
+        //* The slot is free again once every voice let go of it
+        return slot;
+    }
+    void Audio::bindSeekTable([[maybe_unused]] const Sound &sound, [[maybe_unused]] DecoderSlot &slot)
+    {
+#if defined(DRMP3_VERSION_MAJOR)
+        std::shared_ptr<const void> points;
+        {
+            auto scoped = seekTables.scoped();
+            if (auto it = scoped->find(sound.path);
+                it != scoped->end() && it->second.modifiedDate == sound.modifiedDate)
+            {
+                points = it->second.points;
+            }
+        }
+
+        if (!points)
+        {
+            //* Building the table reads the whole file, so it is done in the background for the next time
+            auto result = Globals::gQueue.push_unique(Queue::taskId(Queue::TaskType::SeekTable, sound.id),
+                                                      [this, sound] { buildSeekTable(sound); });
+            if (result == Queue::Result::Full)
+            {
+                Fancy::fancy.logTime().warning()
+                    << "Background queue is full, no seek table will be built for " << sound.path << std::endl;
+            }
+            return;
+        }
+
+        //* miniaudio keeps the dr_mp3 instance of mp3 decoders as their internal decoder
+        const auto &table = *static_cast<const std::vector<drmp3_seek_point> *>(points.get());
+        drmp3_bind_seek_table(static_cast<drmp3 *>(slot.decoder.pInternalDecoder),
+                              static_cast<drmp3_uint32>(table.size()), const_cast<drmp3_seek_point *>(table.data()));
+
+        slot.seekTable = points;
+#endif
+    }
+    void Audio::buildSeekTable([[maybe_unused]] const Sound &sound)
+    {
+#if defined(DRMP3_VERSION_MAJOR)
+        ma_decoder decoder;
+        auto config = ma_decoder_config_init(ma_format_f32, 0, 0);
+#if defined(_WIN32)
+        auto res = ma_decoder_init_file_mp3_w(widen(sound.path).c_str(), &config, &decoder);
+#else
+        auto res = ma_decoder_init_file_mp3(sound.path.c_str(), &config, &decoder);
+#endif
+        if (res != MA_SUCCESS)
+        {
+            return;
+        }
+
+        //* One point per second is plenty, a seek then never decodes more than that
+        const auto seconds = ma_decoder_get_length_in_pcm_frames(&decoder) / std::max(1u, decoder.internalSampleRate);
+        auto count = static_cast<drmp3_uint32>(std::clamp<std::uint64_t>(seconds, 1, 1u << 16));
+
+        auto points = std::make_shared<std::vector<drmp3_seek_point>>(count);
+        if (drmp3_calculate_seek_points(static_cast<drmp3 *>(decoder.pInternalDecoder), &count, points->data()))
+        {
+            points->resize(count);
+            seekTables->insert_or_assign(sound.path, SeekTable{sound.modifiedDate, points});
+        }
+
+        ma_decoder_uninit(&decoder);
+#endif
+    }
+    void Audio::recycleDecoders()
+    {
+        //* Closes the files of decoders that are no longer used, their memory is kept for the next sound
+        auto pool = decoderPool.scoped();
+        for (auto &slot : *pool)
+        {
+            if (slot->initialized && slot.use_count() == 1)
+            {
+                ma_decoder_uninit(&slot->decoder);
+                slot->initialized = false;
+            }
+        }
+    }
+    std::shared_ptr<PlayingSound> Audio::acquireSound()
+    {
+        auto scoped = playingSounds.scoped();
+        for (auto &sound : soundPool)
+        {
+            if (sound.use_count() == 1)
+            {
+                *sound = PlayingSound{};
+                return sound;
+            }
+        }
+
+        return nullptr;
+    }
+    bool Audio::stealVoice(const Sound &sound)
+    {
+        std::optional<PlayingSound> victim;
+        float victimVolume = 0.f;
+        {
+            auto scoped = playingSounds.scoped();
+            auto scopedVoices = voices.scoped();
+
+            for (const auto &[id, playingSound] : *scoped)
+            {
+                //* A sound is as loud as the loudest of its voices, normalization and the remote volume included
+                float volume = 0.f;
+                if (auto group = scopedVoices->find(id); group != scopedVoices->end())
+                {
+                    for (const auto &handle : group->second.voices)
+                    {
+                        volume = std::max(volume, handle.output->voices[handle.slot].effectiveVolume.load(
+                                                      std::memory_order_relaxed));
+                    }
+                }
+
+                if (!victim)
+                {
+                    victim = *playingSound;
+                    victimVolume = volume;
+                    continue;
+                }
+
+                //* Ids only ever grow, so the smallest id is the oldest sound
+                bool better = false;
+                switch (Globals::gSettings.voiceStealing)
+                {
+                case Enums::VoiceStealing::Quietest:
+                    better = volume < victimVolume;
+                    break;
+                case Enums::VoiceStealing::LowestPriority:
+                    better = playingSound->sound.priority < victim->sound.priority ||
+                             (playingSound->sound.priority == victim->sound.priority && id < victim->id);
+                    break;
+                default:
+                    better = id < victim->id;
+                    break;
+                }
+
+                if (better)
+                {
+                    victim = *playingSound;
+                    victimVolume = volume;
+                }
+            }
+        }
+
+        if (!victim)
+        {
+            return false;
+        }
+        if (Globals::gSettings.voiceStealing == Enums::VoiceStealing::LowestPriority &&
+            victim->sound.priority > sound.priority)
+        {
+            Fancy::fancy.logTime().warning() << "Not playing sound " << sound.path
+                                             << ", every voice is used by a sound with a higher priority" << std::endl;
+            return false;
+        }
+
+        //* Just like a sound that finished by itself, the gui is told while the sound is still playing
+        if (Globals::gGui)
+        {
+            Globals::gGui->onSoundFinished(*victim);
+        }
+        stop(victim->id);
+
+        return true;
+    }
+    void Audio::dispatch()
+    {
+        auto lastProgress = std::chrono::steady_clock::now();
+        while (running)
+        {
+            dispatchEvents();
+
+            //* Positions are sampled at a fixed rate, the ui gets one call per tick no matter how many sounds play
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastProgress >= std::chrono::milliseconds(std::max(Globals::gSettings.progressInterval, 10u)))
+            {
+                dispatchProgress();
+                lastProgress = now;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    void Audio::dispatchEvents()
+    {
+        std::vector<std::uint32_t> finished;
+        {
+            auto scoped = outputs.scoped();
+            auto scopedVoices = voices.scoped();
+
+            for (auto &[name, output] : *scoped)
+            {
+                Event event;
+                while (output->events.pop(event))
+                {
+                    auto &voice = output->voices[event.slot];
+                    if (voice.underruns > 0)
+                    {
+                        Fancy::fancy.logTime().warning() << "Sound " << event.id << " ran dry " << voice.underruns
+                                                         << " time(s) while streaming" << std::endl;
+                    }
+
+                    //* The audio thread dropped the voice, it is now safe to release its slot
+                    releaseVoice(output.get(), event.slot);
+
+                    if (scopedVoices->find(event.id) == scopedVoices->end())
+                    {
+                        continue;
+                    }
+
+                    auto &group = scopedVoices->at(event.id);
+                    group.voices.erase(std::remove_if(group.voices.begin(), group.voices.end(),
+                                                      [&](const VoiceHandle &handle) {
+                                                          return handle.output == output.get() &&
+                                                                 handle.slot == event.slot;
+                                                      }),
+                                       group.voices.end());
+
+                    if (event.type == Event::Type::Finished)
+                    {
+                        group.finished = true;
+                    }
+
+                    //* The sound is done once every output has played it
+                    if (group.voices.empty())
+                    {
+                        if (group.finished)
+                        {
+                            finished.emplace_back(event.id);
+                        }
+                        scopedVoices->erase(event.id);
+                    }
+                }
+            }
+        }
+
+        recycleDecoders();
+
+        for (const auto &id : finished)
+        {
+            onFinished(id);
+        }
+    }
+    void Audio::dispatchProgress()
+    {
+        std::vector<PlayingSound> progressed;
+        {
+            auto scoped = playingSounds.scoped();
+            auto scopedVoices = voices.scoped();
+
+            for (auto &[id, sound] : *scoped)
+            {
+                if (!sound->playbackDevice.isDefault || sound->paused ||
+                    scopedVoices->find(id) == scopedVoices->end())
+                {
+                    continue;
+                }
+
+                std::optional<std::uint64_t> readFrames;
+                for (const auto &voice : scopedVoices->at(id).voices)
+                {
+                    if (!voice.remote)
+                    {
+                        readFrames = voice.output->voices[voice.slot].readFrames.load(std::memory_order_relaxed);
+                    }
+                }
+
+                if (readFrames && *readFrames != sound->readFrames)
+                {
+                    sound->readFrames = *readFrames;
+                    updateProgress(*sound);
+                    progressed.emplace_back(*sound);
+                }
+            }
+        }
+
+        if (!progressed.empty() && Globals::gGui)
+        {
+            Globals::gGui->onSoundsProgressed(progressed);
+        }
+    }
+    void Audio::updateProgress(PlayingSound &sound)
+    {
+        //* The length is unknown until the decoder reported it
+        if (sound.length == 0)
+        {
+            return;
+        }
+
+        sound.readInMs = static_cast<std::uint64_t>(
+            (static_cast<double>(sound.readFrames) / static_cast<double>(sound.length)) *
+            static_cast<double>(sound.lengthInMs));
+    }
+    void Audio::stream()
+    {
+        std::vector<float> scratch(Output::streamChunkFrames * 2);
+        std::map<std::shared_ptr<DecoderSlot>, std::vector<Voice *>> streams;
+        std::vector<Preparation> pending;
+
+        while (running)
+        {
+            bool busy = false;
+
+            //* Voices that were just started come first, they are silent until they are prepared
+            {
+                auto scoped = preparations.scoped();
+                std::swap(pending, *scoped);
+            }
+            for (const auto &preparation : pending)
+            {
+                prepare(preparation, scratch.data());
+                busy = true;
+            }
+            pending.clear();
+
+            //* The voices are only claimed under the locks, decoding and seeking happens without them so that
+            //* controlling sounds never waits for the disk
+            streams.clear();
+            {
+                auto scoped = outputs.scoped();
+                auto scopedVoices = voices.scoped();
+
+                for (const auto &[id, group] : *scopedVoices)
+                {
+                    for (const auto &handle : group.voices)
+                    {
+                        auto &voice = handle.output->voices[handle.slot];
+                        if (voice.streaming)
+                        {
+                            voice.decoding.store(true, std::memory_order_release);
+                            streams[voice.decoder].emplace_back(&voice);
+                        }
+                    }
+                }
+            }
+
+            //* Outputs are always opened as stereo
+            for (const auto &[decoder, members] : streams)
+            {
+                if (fillStream(members, 2, scratch.data()))
+                {
+                    busy = true;
+                }
+                for (auto *voice : members)
+                {
+                    voice->decoding.store(false, std::memory_order_release);
+                }
+            }
+
+            if (!busy)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+    }
+    void Audio::prepare(const Preparation &preparation, float *scratch)
+    {
+        const auto &sound = preparation.sound;
+
+        //* A sound that was stopped in the meantime may already have lost its voices, or their output was closed
+        auto isPending = [&](const VoiceHandle &handle) {
+            auto scoped = outputs.scoped();
+            if (std::none_of(scoped->begin(), scoped->end(),
+                             [&](const auto &entry) { return entry.second.get() == handle.output; }))
+            {
+                return false;
+            }
+
+            const auto &voice = handle.output->voices[handle.slot];
+            return voice.used && voice.id == preparation.id &&
+                   voice.prepareState.load(std::memory_order_acquire) == Voice::PrepareState::Pending;
+        };
+
+        std::map<std::pair<std::uint32_t, std::uint32_t>, std::vector<VoiceHandle>> formats;
+        for (const auto &handle : preparation.voices)
+        {
+            if (isPending(handle))
+            {
+                formats[std::make_pair(handle.output->channels, handle.output->sampleRate)].emplace_back(handle);
+            }
+        }
+
+        std::optional<std::uint64_t> localLength;
+        for (const auto &[format, handles] : formats)
+        {
+            const auto &[channels, sampleRate] = format;
+
+            //* Sounds below the stream threshold are decoded as a whole, the cache rejects the others. None of this
+            //* holds a claim on the voices, so stopping them never has to wait for the disk.
+            auto pcm = cache.get(sound, channels, sampleRate);
+            if (!pcm && cache.fits(sound, channels, sampleRate))
+            {
+                pcm = cache.load(sound, channels, sampleRate);
+            }
+
+            std::shared_ptr<DecoderSlot> decoder;
+            std::uint64_t length = 0;
+            if (pcm)
+            {
+                length = pcm->frames;
+            }
+            else if (decoder = createDecoder(sound, channels, sampleRate); decoder)
+            {
+                //* Asking the decoder for the length may scan the whole file, the probed metadata already knows it
+                if (const auto &metadata = sound.metadata; metadata && metadata->sampleRate)
+                {
+                    length = metadata->frames * sampleRate / metadata->sampleRate;
+                }
+                else
+                {
+                    length = ma_decoder_get_length_in_pcm_frames(&decoder->decoder);
+                }
+            }
+
+            //* Claimed like streamed voices while they are handed the result
+            std::vector<Voice *> members;
+            {
+                auto scoped = outputs.scoped();
+                auto scopedVoices = voices.scoped();
+                for (const auto &handle : handles)
+                {
+                    if (isPending(handle))
+                    {
+                        auto &voice = handle.output->voices[handle.slot];
+                        voice.decoding.store(true, std::memory_order_release);
+                        members.emplace_back(&voice);
+
+                        if (!handle.remote)
+                        {
+                            localLength = length;
+                        }
+                    }
+                }
+            }
+            if (members.empty())
+            {
+                continue;
+            }
+
+            for (auto *voice : members)
+            {
+                voice->pcm = pcm;
+                voice->decoder = decoder;
+                voice->length = length;
+
+                if (decoder)
+                {
+                    voice->stream.resize(static_cast<std::size_t>(Output::streamFrames) * channels);
+                }
+                if (pcm || decoder)
+                {
+                    applyLoop(*voice, sound, sampleRate);
+                }
+            }
+
+            if (decoder)
+            {
+                //* Read the first chunk right away so the voices don't start with an underrun
+                fillStream(members, channels, scratch);
+                for (auto *voice : members)
+                {
+                    voice->streaming = true;
+                }
+            }
+
+            const auto state = pcm || decoder ? Voice::PrepareState::Ready : Voice::PrepareState::Failed;
+            for (auto *voice : members)
+            {
+                voice->prepareState.store(state, std::memory_order_release);
+                voice->decoding.store(false, std::memory_order_release);
+            }
+        }
+
+        //* The length the ui was told about was only an estimate, if there was one at all
+        if (localLength && *localLength > 0)
+        {
+            auto scoped = playingSounds.scoped();
+            if (auto it = scoped->find(preparation.id); it != scoped->end())
+            {
+                auto &playing = *it->second;
+                playing.length = *localLength;
+                playing.lengthInMs = static_cast<std::uint64_t>(static_cast<double>(playing.length) /
+                                                                static_cast<double>(playing.sampleRate) * 1000);
+            }
+        }
+    }
+    void Audio::applyLoop(Voice &voice, const Sound &sound, std::uint32_t sampleRate)
+    {
+        if (!sound.loop)
+        {
+            return;
+        }
+
+        const auto sourceRate = voice.pcm ? voice.pcm->sourceRate : voice.decoder->decoder.internalSampleRate;
+        auto convert = [&](std::uint64_t frames) { return sourceRate ? frames * sampleRate / sourceRate : frames; };
+
+        const auto &loop = *sound.loop;
+        voice.loopStart = std::min(convert(loop.start), voice.length);
+        voice.loopEnd = loop.end > loop.start ? std::min(convert(loop.end), voice.length) : 0;
+
+        //* A region that is empty once clamped to the sound would never produce a frame, the whole sound
+        //* is repeated instead
+        const auto regionEnd = voice.loopEnd ? voice.loopEnd : voice.length;
+        if (regionEnd <= voice.loopStart)
+        {
+            Fancy::fancy.logTime().warning() << "Ignoring loop region of " << sound.path
+                                             << ", it is empty or starts past the end" << std::endl;
+            voice.loopStart = 0;
+            voice.loopEnd = 0;
+        }
+        else
+        {
+            //* The crossfade reads the frames right before the start, so it can't be longer than that
+            voice.crossfade = std::min({convert(loop.crossfade), voice.loopStart, regionEnd - voice.loopStart});
+        }
+
+        if (voice.decoder)
+        {
+            //* Streamed sounds are looped by the decode worker, which reads the region from the decoder
+            voice.decoder->loopStart = voice.loopStart;
+            voice.decoder->loopEnd = voice.loopEnd;
+        }
+    }
+    bool Audio::fillStream(const std::vector<Voice *> &members, std::uint32_t channels, float *scratch)
+    {
+        //* Every voice of the stream has to agree before the decoder is touched,
+        //* that way a seek can never make the outputs drift apart.
+        bool seeking = true;
+        bool streaming = true;
+        std::size_t writable = Output::streamFrames * channels;
+
+        for (const auto *voice : members)
+        {
+            auto state = voice->streamState.load(std::memory_order_acquire);
+            seeking = seeking && state == Voice::StreamState::Seeking;
+            streaming = streaming && state == Voice::StreamState::Streaming;
+            writable = std::min(writable, voice->stream.writable());
+        }
+
+        auto *first = members.front();
+        auto &source = *first->decoder;
+        auto *decoder = &source.decoder;
+
+        if (seeking)
+        {
+            source.frame = source.seekRequest;
+            ma_decoder_seek_to_pcm_frame(decoder, source.frame);
+
+            for (auto *voice : members)
+            {
+                voice->endOfStream = false;
+                voice->streamState.store(Voice::StreamState::Seeked, std::memory_order_release);
+            }
+
+            return true;
+        }
+        if (!streaming || first->endOfStream || writable / channels < Output::streamChunkFrames)
+        {
+            return false;
+        }
+
+        //* Stop exactly at the end of the loop region so that the start follows right after it
+        std::uint64_t toRead = Output::streamChunkFrames;
+        const bool loopRegion = first->loop && source.loopEnd > 0;
+        if (loopRegion && source.loopEnd > source.frame)
+        {
+            toRead = std::min(toRead, source.loopEnd - source.frame);
+        }
+
+        auto readFrames = ma_decoder_read_pcm_frames(decoder, scratch, toRead);
+        source.frame += readFrames;
+
+        for (auto *voice : members)
+        {
+            voice->stream.write(scratch, readFrames * channels);
+        }
+
+        if (readFrames < toRead || (loopRegion && source.frame >= source.loopEnd))
+        {
+            if (first->loop)
+            {
+                ma_decoder_seek_to_pcm_frame(decoder, source.loopStart);
+                source.frame = source.loopStart;
+            }
+            else
+            {
+                for (auto *voice : members)
+                {
+                    voice->endOfStream.store(true, std::memory_order_release);
+                }
+            }
+        }
+
+        return readFrames > 0;
+    }
+    std::optional<PlayingSound> Audio::play(const Objects::Sound &sound,
+                                            const std::optional<Objects::AudioDevice> &remoteDevice)
+    {
+        static std::atomic<std::uint64_t> id = 0;
+
+        //* The setting is clamped when it is loaded or changed, this only guards against it being set directly
+        const auto limit = std::clamp<std::size_t>(Globals::gSettings.maxVoices, 1, maxSounds);
+        while (playingSounds->size() >= limit)
+        {
+            if (!stealVoice(sound))
+            {
+                return std::nullopt;
+            }
+        }
+
+        //* The pool holds as many sounds as can play at once, two plays racing for the last one can still miss it
+        auto pSound = acquireSound();
+        if (!pSound)
+        {
+            Fancy::fancy.logTime().warning() << "Failed to play sound " << sound.path << ", all " << maxSounds
+                                             << " sounds are in use" << std::endl;
+            return std::nullopt;
+        }
+
+        std::vector<std::pair<Output *, bool>> targets;
+        {
+            //* Held while looking up the outputs, so the default device can't be switched in between
+            auto scoped = outputs.scoped();
+            for (const auto &[device, remote] : {std::make_pair(std::optional(defaultPlayback), false),
+                                                 std::make_pair(remoteDevice, true)})
+            {
+                if (!device)
+                {
+                    continue;
+                }
+
+                auto *output = getOutput(*device);
+                if (!output)
+                {
+                    Fancy::fancy.logTime().warning() << "Failed to play sound " << sound.path << " on " << device->name
+                                                     << ", no output available" << std::endl;
+                    return std::nullopt;
+                }
+
+                targets.emplace_back(output, remote);
+            }
+        }
+
+        auto soundId = static_cast<std::uint32_t>(++id);
+
+        VoiceGroup group;
+        Preparation preparation;
+
+        auto abort = [&] {
+            for (const auto &handle : group.voices)
+            {
+                releaseVoice(handle.output, handle.slot);
+            }
+            return std::nullopt;
+        };
+
+        for (const auto &[output, remote] : targets)
+        {
+            auto slot = acquireVoice(output);
+            if (!slot)
+            {
+                Fancy::fancy.logTime().warning() << "Failed to play sound " << sound.path << ", all "
+                                                 << Output::maxVoices << " voices are in use" << std::endl;
+                return abort();
+            }
+            group.voices.push_back({output, *slot, remote});
+
+            const auto channels = output->channels;
+            const auto sampleRate = output->sampleRate;
+
+            auto &voice = output->voices[*slot];
+            voice.id = soundId;
+            voice.pcm = cache.get(sound, channels, sampleRate);
+
+            if (voice.pcm)
+            {
+                voice.length = voice.pcm->frames;
+                applyLoop(voice, sound, sampleRate);
+            }
+            else
+            {
+                //* Everything that may touch the disk is left to the decode worker, the voice is silent until then
+                voice.prepareState = Voice::PrepareState::Pending;
+                preparation.voices.push_back(group.voices.back());
+
+                //* Only known once the worker opened the file, unless the sound was probed already
+                if (const auto &metadata = sound.metadata; metadata && metadata->sampleRate)
+                {
+                    voice.length = metadata->frames * sampleRate / metadata->sampleRate;
+                }
+            }
+
+            std::optional<int> customVolume = remote ? sound.remoteVolume : sound.localVolume;
+            int volume = remote ? Globals::gSettings.remoteVolume : Globals::gSettings.localVolume;
+
+            voice.normalization = getNormalization(sound);
+            voice.volume = static_cast<float>(customVolume ? *customVolume : volume) / 100.f * voice.normalization;
+            voice.gain = voice.volume;
+            voice.effectiveVolume = voice.volume;
+        }
+
+        const auto &local = group.voices.front();
+        const auto &localVoice = local.output->voices[local.slot];
+
+        pSound->id = soundId;
+        pSound->sound = sound;
+        pSound->length = localVoice.length;
+        pSound->volume = localVoice.volume / localVoice.normalization;
+        pSound->sampleRate = local.output->sampleRate;
+        pSound->playbackDevice = local.output->playbackDevice;
+        pSound->lengthInMs = static_cast<std::uint64_t>(static_cast<double>(pSound->length) /
+                                                        static_cast<double>(pSound->sampleRate) * 1000);
+
+        auto scoped = playingSounds.scoped();
+        auto scopedOutputs = outputs.scoped();
+        auto scopedVoices = voices.scoped();
+
+        VoiceGroup started;
+        for (const auto &handle : group.voices)
+        {
+            Command command;
+            command.type = Command::Type::Play;
+            command.id = soundId;
+            command.slot = handle.slot;
+
+            if (send(handle.output, command))
+            {
+                started.voices.emplace_back(handle);
+            }
+            else
+            {
+                releaseVoice(handle.output, handle.slot);
+            }
+        }
+
+        if (started.voices.size() != group.voices.size())
+        {
+            //* The voices that were started are released once the audio thread confirms the stop
+            for (const auto &handle : started.voices)
+            {
+                Command command;
+                command.type = Command::Type::Stop;
+                command.id = soundId;
+                command.slot = handle.slot;
+
+                send(handle.output, command);
+            }
+
+            if (!started.voices.empty())
+            {
+                scopedVoices->emplace(soundId, started);
+            }
+            return std::nullopt;
+        }
+
+        scopedVoices->emplace(soundId, group);
+        scoped->emplace(soundId, pSound);
+
+        if (!preparation.voices.empty())
+        {
+            preparation.id = soundId;
+            preparation.sound = sound;
+            preparations->emplace_back(std::move(preparation));
+        }
+
+        return *pSound;
+    }
+    void Audio::stopAll()
+    {
+        auto scoped = playingSounds.scoped();
+        for (const auto &[id, sound] : *scoped)
+        {
+            Command command;
+            command.type = Command::Type::Stop;
+            command.id = id;
 
-            scoped->erase(sound->id);
+            send(command);
         }
+        scoped->clear();
     }
     bool Audio::stop(const std::uint32_t &soundId)
     {
         auto scoped = playingSounds.scoped();
         if (scoped->find(soundId) != scoped->end())
         {
-            auto &sound = scoped->at(soundId);
-            if (sound->raw.device && sound->raw.decoder)
-            {
-                ma_device_uninit(sound->raw.device);
-                ma_decoder_uninit(sound->raw.decoder);
-            }
+            Command command;
+            command.type = Command::Type::Stop;
+            command.id = soundId;
 
-            sound->raw.device = nullptr;
-            sound->raw.decoder = nullptr;
+            send(command);
+            scoped->erase(soundId);
 
-            scoped->erase(sound->id);
             return true;
         }
 
@@ -188,15 +1782,13 @@ namespace Soundux::Objects
         {
             auto &sound = scoped->at(soundId);
 
-            if (!sound->paused)
-            {
-                if (ma_device_get_state(sound->raw.device) == MA_STATE_STARTED)
-                {
-                    ma_device_stop(sound->raw.device);
-                }
-                sound->paused = true;
-            }
+            Command command;
+            command.type = Command::Type::Pause;
+            command.id = soundId;
 
+            send(command);
+
+            sound->paused = true;
             return *sound;
         }
 
@@ -210,8 +1802,15 @@ namespace Soundux::Objects
         if (scoped->find(soundId) != scoped->end())
         {
             auto &sound = scoped->at(soundId);
-            sound->repeat = shouldRepeat;
 
+            Command command;
+            command.type = Command::Type::Repeat;
+            command.id = soundId;
+            command.state = shouldRepeat;
+
+            send(command);
+
+            sound->repeat = shouldRepeat;
             return *sound;
         }
 
@@ -226,146 +1825,634 @@ namespace Soundux::Objects
         {
             auto &sound = scoped->at(soundId);
 
-            if (sound->paused)
+            Command command;
+            command.type = Command::Type::Resume;
+            command.id = soundId;
+
+            send(command);
+
+            sound->paused = false;
+            return *sound;
+        }
+
+        Fancy::fancy.logTime().warning() << "Failed to resume sound with id " << soundId << ", sound does not exist "
+                                         << std::endl;
+        return std::nullopt;
+    }
+    void Audio::onFinished(const std::uint32_t &soundId)
+    {
+        auto scoped = playingSounds.scoped();
+        if (scoped->find(soundId) != scoped->end())
+        {
+            if (Globals::gGui)
             {
-                if (ma_device_get_state(sound->raw.device) == MA_STATE_STOPPED)
-                {
-                    ma_device_start(sound->raw.device);
-                }
-                sound->paused = false;
+                Globals::gGui->onSoundFinished(*scoped->at(soundId));
+            }
+            scoped->erase(soundId);
+        }
+    }
+    std::optional<PlayingSound> Audio::seek(const std::uint32_t &soundId, std::uint64_t position)
+    {
+        auto scoped = playingSounds.scoped();
+        if (scoped->find(soundId) != scoped->end())
+        {
+            auto &sound = scoped->at(soundId);
+
+            Command command;
+            command.type = Command::Type::Seek;
+            command.id = soundId;
+            command.position = position;
+
+            send(command);
+
+            //* The length is unknown while the sound is still being prepared
+            if (sound->lengthInMs > 0)
+            {
+                sound->readFrames = static_cast<std::uint64_t>(
+                    (static_cast<double>(position) / static_cast<double>(sound->lengthInMs)) *
+                    static_cast<double>(sound->length));
+                updateProgress(*sound);
             }
 
             return *sound;
         }
 
-        Fancy::fancy.logTime().warning() << "Failed to resume sound with id " << soundId << ", sound does not exist "
+        Fancy::fancy.logTime().warning() << "Failed to seek sound with id " << soundId << ", sound does not exist"
                                          << std::endl;
         return std::nullopt;
     }
-    void Audio::onFinished(PlayingSound sound)
+    bool Audio::setLocalVolume(const std::uint32_t &soundId, float volume)
+    {
+        auto scoped = playingSounds.scoped();
+        if (scoped->find(soundId) != scoped->end())
+        {
+            Command command;
+            command.type = Command::Type::Volume;
+            command.id = soundId;
+            command.volume = volume;
+
+            send(command, false);
+
+            scoped->at(soundId)->volume = volume;
+            return true;
+        }
+
+        Fancy::fancy.logTime().warning() << "Failed to set volume of sound with id " << soundId
+                                         << ", sound does not exist" << std::endl;
+        return false;
+    }
+    bool Audio::setRemoteVolume(const std::uint32_t &soundId, float volume)
     {
         auto scoped = playingSounds.scoped();
-        if (scoped->find(sound.id) != scoped->end())
+        if (scoped->find(soundId) != scoped->end())
         {
-            ma_device_uninit(sound.raw.device);
-            ma_decoder_uninit(sound.raw.decoder);
+            Command command;
+            command.type = Command::Type::Volume;
+            command.id = soundId;
+            command.volume = volume;
 
-            sound.raw.device = nullptr;
-            sound.raw.decoder = nullptr;
+            //* Not every sound is played remotely, so this is allowed to not reach any voice
+            send(command, true);
+            return true;
+        }
 
-            Globals::gGui->onSoundFinished(sound);
-            scoped->erase(sound.id);
+        Fancy::fancy.logTime().warning() << "Failed to set remote volume of sound with id " << soundId
+                                         << ", sound does not exist" << std::endl;
+        return false;
+    }
+    void Audio::seekVoice(Voice *voice, std::uint64_t frame)
+    {
+        if (voice->pcm)
+        {
+            voice->pcmFrame = std::min(frame, voice->pcm->frames);
+        }
+        else if (voice->streamState.load(std::memory_order_acquire) == Voice::StreamState::Streaming)
+        {
+            voice->pendingSeek.reset();
+            voice->decoder->seekRequest = frame;
+            voice->streamState.store(Voice::StreamState::Seeking, std::memory_order_release);
         }
         else
         {
-            Fancy::fancy.logTime().warning() << "Sound finished but is not playing" << std::endl;
+            //* The worker is still busy with the previous seek, this one is sent once it is done
+            voice->pendingSeek = frame;
         }
+
+        voice->readFrames.store(frame, std::memory_order_relaxed);
     }
-    void Audio::onSoundProgressed(PlayingSound *sound, std::uint64_t frames)
+    void Audio::fadeVoice(Voice *voice, float target, std::uint32_t frames, Voice::FadeAction action)
     {
-        sound->readFrames += frames;
-        sound->buffer += frames;
+        voice->fadeTarget = target;
+        voice->fadeAction = action;
+        voice->fadeFrames = frames;
+        voice->fadeStep = frames > 0 ? (target - voice->fade) / static_cast<float>(frames) : 0.f;
 
-        if (sound->buffer > (sound->sampleRate / 2))
+        if (frames == 0)
         {
-            sound->readInMs = static_cast<std::uint64_t>(
-                (static_cast<double>(sound->readFrames) / static_cast<double>(sound->length)) *
-                static_cast<double>(sound->lengthInMs));
+            finishFade(voice, frames);
+        }
+    }
+    void Audio::finishFade(Voice *voice, std::uint32_t length)
+    {
+        voice->fade = voice->fadeTarget;
+        voice->fadeFrames = 0;
+        voice->fadeStep = 0;
 
-            Globals::gGui->onSoundProgressed(*sound);
+        const auto action = voice->fadeAction;
+        voice->fadeAction = Voice::FadeAction::None;
 
-            sound->buffer = 0;
+        switch (action)
+        {
+        case Voice::FadeAction::Stop:
+            voice->stopped = true;
+            break;
+        case Voice::FadeAction::Pause:
+            voice->paused = true;
+            break;
+        case Voice::FadeAction::Seek:
+            seekVoice(voice, voice->fadeSeek);
+            fadeVoice(voice, 1.f, length, Voice::FadeAction::None);
+            break;
+        default:
+            break;
         }
     }
-    void Audio::onSoundSeeked(PlayingSound *sound, std::uint64_t frame)
+    std::uint64_t Audio::wrapLoop(const Voice *voice, std::uint64_t position)
     {
-        sound->shouldSeek = false;
-        sound->readFrames = frame;
-        sound->readInMs = static_cast<std::uint64_t>((static_cast<double>(frame) / static_cast<double>(sound->length)) *
-                                                     static_cast<double>(sound->lengthInMs));
+        const auto end = voice->loopEnd ? voice->loopEnd : voice->length;
+        if (end <= voice->loopStart || position < end)
+        {
+            return position;
+        }
+
+        return voice->loopStart + (position - end) % (end - voice->loopStart);
     }
-    std::optional<PlayingSound> Audio::seek(const std::uint32_t &soundId, std::uint64_t position)
+    void Audio::mix(Output *output, Voice *voice, float *buffer, std::uint32_t frameCount)
     {
-        auto scoped = playingSounds.scoped();
-        if (scoped->find(soundId) != scoped->end())
+        const auto channels = output->channels;
+        const auto fadeLength = output->sampleRate * output->fadeMs.load(std::memory_order_relaxed) / 1000;
+        std::uint64_t mixedFrames = 0;
+
+        //* Pending voices neither play nor advance, their fade in starts once they are ready
+        switch (voice->prepareState.load(std::memory_order_acquire))
         {
-            auto &sound = scoped->at(soundId);
-            sound->seekTo =
-                static_cast<std::uint64_t>((static_cast<double>(position) / static_cast<double>(sound->lengthInMs)) *
-                                           static_cast<double>(sound->length));
-            sound->shouldSeek = true;
+        case Voice::PrepareState::Pending:
+            return;
+        case Voice::PrepareState::Failed:
+            voice->finished = true;
+            return;
+        default:
+            break;
+        }
+
+        //* Seeks that came in while the voice was pending
+        if (voice->pendingSeek && (voice->pcm || voice->streamState.load(std::memory_order_relaxed) ==
+                                                     Voice::StreamState::Streaming))
+        {
+            const auto frame = *voice->pendingSeek;
+            voice->pendingSeek.reset();
+            seekVoice(voice, frame);
+        }
 
-            auto rtn = *sound;
-            rtn.readFrames = rtn.seekTo;
-            rtn.readInMs =
-                static_cast<std::uint64_t>((static_cast<double>(rtn.seekTo) / static_cast<double>(rtn.length)) *
-                                           static_cast<double>(rtn.lengthInMs));
+        if (!voice->pcm)
+        {
+            if (voice->streamState.load(std::memory_order_acquire) == Voice::StreamState::Seeked)
+            {
+                voice->stream.discard();
+                voice->streamState.store(Voice::StreamState::Streaming, std::memory_order_release);
+
+                if (voice->pendingSeek)
+                {
+                    seekVoice(voice, *voice->pendingSeek);
+                }
+            }
 
-            return rtn;
+            //* Stay silent until the worker has caught up with the seek
+            if (voice->streamState.load(std::memory_order_relaxed) != Voice::StreamState::Streaming)
+            {
+                return;
+            }
         }
 
-        Fancy::fancy.logTime().warning() << "Failed to seek sound with id " << soundId << ", sound does not exist"
-                                         << std::endl;
-        return std::nullopt;
+        while (frameCount > mixedFrames)
+        {
+            auto toRead = std::min<std::uint64_t>(frameCount - mixedFrames, Output::scratchFrames);
+            if (voice->fadeFrames > 0)
+            {
+                //* Chunks end where the envelope does, so that its action happens on the exact frame
+                toRead = std::min<std::uint64_t>(toRead, voice->fadeFrames);
+            }
+
+            const float *source = nullptr;
+            std::uint64_t readFrames = 0;
+
+            //* Cached sounds wrap at the end of the loop region within the same period, which makes them gapless
+            bool atEnd = false;
+            const float *fadeIn = nullptr;
+            float fadeStart = 0;
+            float fadeEnd = 0;
+
+            if (voice->pcm)
+            {
+                const auto &pcm = *voice->pcm;
+                const bool looping = voice->repeat && voice->loopEnd > voice->pcmFrame;
+                const auto end = looping ? std::min(voice->loopEnd, pcm.frames) : pcm.frames;
+
+                readFrames = std::min(toRead, end - std::min(end, voice->pcmFrame));
+                source = pcm.data.data() + voice->pcmFrame * pcm.channels;
+
+                if (voice->repeat && voice->crossfade > 0 && voice->pcmFrame < end)
+                {
+                    //* The last frames of the region are blended with the frames leading up to its start
+                    const auto crossfadeStart = end - voice->crossfade;
+                    if (voice->pcmFrame < crossfadeStart)
+                    {
+                        readFrames = std::min(readFrames, crossfadeStart - voice->pcmFrame);
+                    }
+                    else
+                    {
+                        const auto offset = voice->pcmFrame - crossfadeStart;
+                        const auto length = static_cast<float>(voice->crossfade);
+
+                        fadeIn = pcm.data.data() + (voice->loopStart - voice->crossfade + offset) * pcm.channels;
+                        fadeStart = static_cast<float>(offset) / length;
+                        fadeEnd = static_cast<float>(offset + readFrames) / length;
+                    }
+                }
+
+                voice->pcmFrame += readFrames;
+                atEnd = voice->pcmFrame >= end;
+            }
+            else
+            {
+                readFrames = voice->stream.read(output->scratch.data(), toRead * channels) / channels;
+                source = output->scratch.data();
+            }
+
+            //* The outputs are always opened as f32 stereo
+            auto *target = buffer + mixedFrames * channels;
+            std::uint64_t rampedFrames = 0;
+
+            //* The envelope is linear within the chunk, it scales whatever gain the chunk is mixed with
+            auto envelope = [&](std::uint64_t frame) {
+                return voice->fade + voice->fadeStep * static_cast<float>(frame);
+            };
+
+            if (fadeIn)
+            {
+                const auto start = voice->gain * envelope(0);
+                const auto end = voice->gain * envelope(readFrames);
+
+                Helpers::mixStereo(target, source, readFrames, start * (1.f - fadeStart), end * (1.f - fadeEnd));
+                Helpers::mixStereo(target, fadeIn, readFrames, start * fadeStart, end * fadeEnd);
+
+                //* Volume changes are picked up again once the crossfade is done
+                rampedFrames = readFrames;
+            }
+            else if (voice->rampFrames > 0)
+            {
+                rampedFrames = std::min<std::uint64_t>(readFrames, voice->rampFrames);
+
+                auto end = voice->gain + (voice->volume - voice->gain) * static_cast<float>(rampedFrames) /
+                                             static_cast<float>(voice->rampFrames);
+                Helpers::mixStereo(target, source, rampedFrames, voice->gain * envelope(0),
+                                   end * envelope(rampedFrames));
+
+                voice->rampFrames -= static_cast<std::uint32_t>(rampedFrames);
+                voice->gain = voice->rampFrames > 0 ? end : voice->volume;
+            }
+
+            Helpers::mixStereo(target + rampedFrames * channels, source + rampedFrames * channels,
+                               readFrames - rampedFrames, voice->gain * envelope(rampedFrames),
+                               voice->gain * envelope(readFrames));
+
+            mixedFrames += readFrames;
+
+            bool fadeDone = false;
+            if (voice->fadeFrames > 0 && readFrames > 0)
+            {
+                voice->fade = envelope(readFrames);
+                voice->fadeFrames -= static_cast<std::uint32_t>(readFrames);
+                fadeDone = voice->fadeFrames == 0;
+            }
+
+            //* Streaming voices are looped by the worker, so the position has to wrap here
+            auto position = voice->readFrames.load(std::memory_order_relaxed) + readFrames;
+            if (voice->repeat)
+            {
+                position = wrapLoop(voice, position);
+            }
+            voice->readFrames.store(position, std::memory_order_relaxed);
+
+            if (fadeDone && voice->fadeAction != Voice::FadeAction::None)
+            {
+                finishFade(voice, fadeLength);
+
+                //* Stopped and paused voices are done for this period, streamed voices wait for the seek
+                if (voice->stopped || voice->paused || !voice->pcm)
+                {
+                    break;
+                }
+                continue;
+            }
+            if (fadeDone)
+            {
+                finishFade(voice, fadeLength);
+            }
+
+            if (voice->pcm && voice->repeat && atEnd)
+            {
+                //* Fill the rest of the period from the start of the loop
+                seekVoice(voice, voice->loopStart);
+                if (voice->pcmFrame < voice->pcm->frames)
+                {
+                    continue;
+                }
+                break;
+            }
+
+            //* Cached reads are cut short at the start of a crossfade, that is not the end of the sound
+            if (voice->pcm && readFrames < toRead && !atEnd)
+            {
+                continue;
+            }
+
+            if (readFrames < toRead)
+            {
+                if (!voice->pcm)
+                {
+                    if (!voice->endOfStream.load(std::memory_order_acquire))
+                    {
+                        voice->underruns++;
+                        output->underruns++;
+                        output->framesStarved.fetch_add(frameCount - mixedFrames, std::memory_order_relaxed);
+                        break;
+                    }
+                    if (voice->stream.readable() > 0)
+                    {
+                        continue;
+                    }
+                }
+
+                if (voice->repeat)
+                {
+                    seekVoice(voice, voice->loopStart);
+                }
+                else
+                {
+                    voice->finished = true;
+                }
+                break;
+            }
+        }
     }
     void Audio::data_callback(ma_device *device, void *output, [[maybe_unused]] const void *input,
                               std::uint32_t frameCount)
     {
-        auto *sound = reinterpret_cast<PlayingSound *>(device->pUserData);
-        if (!sound)
+        auto *out = reinterpret_cast<Output *>(device->pUserData);
+        if (out)
         {
-            return;
+            render(out, reinterpret_cast<float *>(output), frameCount);
         }
-
-        if (!sound->raw.decoder)
+    }
+    void Audio::capture_callback(ma_device *device, [[maybe_unused]] void *output, const void *input,
+                                 std::uint32_t frameCount)
+    {
+        auto *out = reinterpret_cast<Output *>(device->pUserData);
+        if (out)
         {
-            return;
+            out->input.write(reinterpret_cast<const float *>(input),
+                             static_cast<std::size_t>(frameCount) * device->capture.channels);
+        }
+    }
+    void Audio::mixInput(Output *out, float *buffer, std::uint32_t frameCount)
+    {
+        //* The ducking gain is updated in small blocks and ramped within them
+        constexpr std::uint32_t blockFrames = 64;
+        //* Capture and playback clocks drift apart, anything older than this is dropped to keep the delay low
+        constexpr std::uint32_t maxDelayMs = 20;
+
+        const auto maxBacklog =
+            (static_cast<std::size_t>(frameCount) + out->sampleRate * maxDelayMs / 1000) * out->channels;
+        while (out->input.readable() > maxBacklog)
+        {
+            out->input.read(out->scratch.data(), std::min(out->input.readable() - maxBacklog, out->scratch.size()));
         }
 
-        auto readFrames = ma_decoder_read_pcm_frames(sound->raw.decoder, output, frameCount);
-        if (sound->shouldSeek)
+        for (std::uint32_t offset = 0; frameCount > offset; offset += blockFrames)
         {
-            ma_decoder_seek_to_pcm_frame(sound->raw.decoder, sound->seekTo);
-            Globals::gAudio.onSoundSeeked(sound, sound->seekTo);
+            const auto frames = std::min(blockFrames, frameCount - offset);
+            auto *target = buffer + static_cast<std::size_t>(offset) * 2;
+
+            //* The sounds mixed so far are the sidechain
+            const auto start = out->ducker.getGain();
+            const auto end = out->ducker.process(target, frames, out->sampleRate);
+
+            const auto read = out->input.read(out->scratch.data(), static_cast<std::size_t>(frames) * 2) / 2;
+            Helpers::mixStereo(target, out->scratch.data(), read, start,
+                               start + (end - start) * static_cast<float>(read) / static_cast<float>(frames));
         }
-        if (sound->playbackDevice.isDefault && readFrames > 0)
+    }
+    void Audio::render(Output *out, float *buffer, std::uint32_t frameCount)
+    {
+        //* Nothing in here may lock, allocate or call into the gui, everything goes through the queues instead
+        const auto start = std::chrono::steady_clock::now();
+
+        Command command;
+        while (out->commands.pop(command))
         {
-            Globals::gAudio.onSoundProgressed(sound, readFrames);
+            auto &voice = out->voices[command.slot];
+            const auto fadeLength = out->sampleRate * out->fadeMs.load(std::memory_order_relaxed) / 1000;
+
+            if (command.type == Command::Type::Play)
+            {
+                voice.playing = true;
+                out->active[out->activeVoices++] = command.slot;
+
+                voice.fade = 0.f;
+                fadeVoice(&voice, 1.f, fadeLength, Voice::FadeAction::None);
+
+                continue;
+            }
+
+            //* The slot may already have been handed to another sound
+            if (!voice.playing || voice.id != command.id)
+            {
+                continue;
+            }
+
+            //* Pending voices are silent as well, but they can't be seeked before they are ready
+            const auto pending = voice.prepareState.load(std::memory_order_acquire) != Voice::PrepareState::Ready;
+
+            switch (command.type)
+            {
+            //* Paused voices are silent already, everything else fades out first
+            case Command::Type::Stop:
+                if (voice.paused || pending)
+                {
+                    voice.stopped = true;
+                    break;
+                }
+                fadeVoice(&voice, 0.f, fadeLength, Voice::FadeAction::Stop);
+                break;
+            case Command::Type::Seek:
+                voice.fadeSeek = command.position * out->sampleRate / 1000;
+                if (pending)
+                {
+                    voice.pendingSeek = voice.fadeSeek;
+                    voice.readFrames.store(voice.fadeSeek, std::memory_order_relaxed);
+                    break;
+                }
+                if (voice.paused || voice.fadeAction == Voice::FadeAction::Pause)
+                {
+                    seekVoice(&voice, voice.fadeSeek);
+                    break;
+                }
+                if (voice.fadeAction != Voice::FadeAction::Stop)
+                {
+                    fadeVoice(&voice, 0.f, fadeLength, Voice::FadeAction::Seek);
+                }
+                break;
+            case Command::Type::Pause:
+                if (pending)
+                {
+                    voice.paused = true;
+                    break;
+                }
+                if (!voice.paused && voice.fadeAction != Voice::FadeAction::Stop)
+                {
+                    fadeVoice(&voice, 0.f, fadeLength, Voice::FadeAction::Pause);
+                }
+                break;
+            case Command::Type::Resume:
+                if (voice.paused || voice.fadeAction == Voice::FadeAction::Pause)
+                {
+                    voice.paused = false;
+                    fadeVoice(&voice, 1.f, fadeLength, Voice::FadeAction::None);
+                }
+                break;
+            case Command::Type::Repeat:
+                voice.repeat = command.state;
+                voice.loop = command.state;
+                break;
+            case Command::Type::Volume:
+                voice.volume = command.volume * voice.normalization;
+                voice.effectiveVolume.store(voice.volume, std::memory_order_relaxed);
+                voice.rampFrames = out->sampleRate * Output::volumeRampMs / 1000;
+                break;
+            default:
+                break;
+            }
         }
 
-        if (readFrames <= 0)
+        for (std::size_t i = 0; out->activeVoices > i;)
         {
-            if (sound->repeat)
+            const auto slot = out->active[i];
+            auto &voice = out->voices[slot];
+
+            if (!voice.paused && !voice.stopped && !voice.finished)
             {
-                ma_decoder_seek_to_pcm_frame(sound->raw.decoder, 0);
-                Globals::gAudio.onSoundSeeked(sound, 0);
+                mix(out, &voice, buffer, frameCount);
             }
-            else
+
+            if (voice.stopped || voice.finished)
+            {
+                //* If the event queue is full the voice is kept around and reported on the next period,
+                //* this way every voice is reported exactly once.
+                if (out->events.push({voice.stopped ? Event::Type::Removed : Event::Type::Finished, voice.id, slot}))
+                {
+                    voice.playing = false;
+                    out->active[i] = out->active[--out->activeVoices];
+                    continue;
+                }
+            }
+
+            i++;
+        }
+
+        if (out->inputActive.load(std::memory_order_acquire))
+        {
+            mixInput(out, buffer, frameCount);
+        }
+
+        const auto reduction = out->limiter.process(buffer, frameCount, out->sampleRate);
+        if (reduction > 0.f)
+        {
+            out->limitedPeriods.fetch_add(1, std::memory_order_relaxed);
+            if (reduction > out->gainReduction.load(std::memory_order_relaxed))
             {
-                Globals::gQueue.push_unique(reinterpret_cast<std::uintptr_t>(device),
-                                            [sound = *sound] { Globals::gAudio.onFinished(sound); });
+                out->gainReduction.store(reduction, std::memory_order_relaxed);
             }
         }
+
+        //* Tells how long it took from triggering a sound until it reached the device
+        auto *end = buffer + static_cast<std::size_t>(frameCount) * out->channels;
+        const auto audible = std::any_of(buffer, end, [](float sample) { return sample != 0.f; });
+        if (audible && !out->audible)
+        {
+            out->audibleAt.store(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count(),
+                std::memory_order_relaxed);
+        }
+        out->audible = audible;
+
+        const std::uint64_t elapsed =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        const auto deadline = static_cast<std::uint64_t>(frameCount) * 1000000000ull / out->sampleRate;
+
+        out->callbacks.fetch_add(1, std::memory_order_relaxed);
+        out->callbackTime.fetch_add(elapsed, std::memory_order_relaxed);
+        out->framesRequested.fetch_add(frameCount, std::memory_order_relaxed);
+        out->deadline.store(deadline, std::memory_order_relaxed);
+        if (elapsed > deadline)
+        {
+            out->deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //* Only the audio thread writes it, so there is no need for a compare exchange
+        if (elapsed > out->worstCallback.load(std::memory_order_relaxed))
+        {
+            out->worstCallback.store(elapsed, std::memory_order_relaxed);
+        }
+
+        std::size_t bucket = 0;
+        for (auto limit = Output::histogramStart * 1000; Output::histogramSize > bucket + 1 && elapsed >= limit;
+             limit <<= 1)
+        {
+            bucket++;
+        }
+        out->histogram[bucket].fetch_add(1, std::memory_order_relaxed);
     }
     std::vector<AudioDevice> Audio::getAudioDevices()
     {
-        std::string defaultName;
+        if (auto cached = devices.copy(); !cached.empty())
         {
-            ma_device device;
-            ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
-            ma_device_init(nullptr, &deviceConfig, &device);
-
-            defaultName = device.playback.name;
-
-            ma_device_uninit(&device);
+            return cached;
         }
 
-        ma_context context;
+        return refreshDevices();
+    }
+    std::vector<AudioDevice> Audio::refreshDevices()
+    {
+        if (!hasContext)
+        {
+            const ma_backend null = ma_backend_null;
+            hasContext = ma_context_init(nullBackend ? &null : nullptr, nullBackend ? 1 : 0, nullptr, &context) ==
+                         MA_SUCCESS;
+            if (!hasContext)
+            {
+                Fancy::fancy.logTime().failure() << "Failed to initialize context" << std::endl;
+                return {};
+            }
+        }
 
-        if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS)
+        //* Querying the info without an id yields the default device
+        std::string defaultName;
+        if (ma_device_info info;
+            ma_context_get_device_info(&context, ma_device_type_playback, nullptr, ma_share_mode_shared, &info) ==
+            MA_SUCCESS)
         {
-            Fancy::fancy.logTime().failure() << "Failed to initialize context" << std::endl;
-            return {};
+            defaultName = info.name;
         }
 
         ma_device_info *pPlayBackDeviceInfos{};
@@ -391,8 +2478,6 @@ namespace Soundux::Objects
             playBackDevices.emplace_back(device);
         }
 
-        ma_context_uninit(&context);
-
         for (auto it = playBackDevices.begin(); it != playBackDevices.end(); it++)
         {
             if (it->name.find("VB-Audio") != std::string::npos)
@@ -404,8 +2489,38 @@ namespace Soundux::Objects
             }
         }
 
+        devices = playBackDevices;
         return playBackDevices;
     }
+    void Audio::onDevicesChanged()
+    {
+        auto refresh = [this] {
+            if (!running)
+            {
+                return;
+            }
+
+            auto previous = devices.copy();
+            auto current = refreshDevices();
+
+            if (previous.size() != current.size())
+            {
+                Fancy::fancy.logTime().message()
+                    << "Audio devices changed, " << current.size() << " devices available" << std::endl;
+            }
+            for (const auto &device : current)
+            {
+                if (device.isDefault && device.name != getDefaultPlayback().name)
+                {
+                    Fancy::fancy.logTime().message() << "Default playback device is now " << device.name << std::endl;
+                    switchDefaultPlayback(device);
+                }
+            }
+        };
+
+        Globals::gQueue.push_unique(Queue::taskId(Queue::TaskType::RefreshDevices), std::move(refresh),
+                                    Queue::Lane::Control);
+    }
 #if defined(_WIN32)
     std::optional<AudioDevice> Audio::getAudioDevice(const std::string &name)
     {
@@ -431,6 +2546,53 @@ namespace Soundux::Objects
 
         return rtn;
     }
+    void Voice::reset()
+    {
+        //* The decode worker finishes the chunk it is working on before the voice can be reused or destroyed
+        while (decoding.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+
+        decoder = nullptr;
+        pcm = nullptr;
+        pcmFrame = 0;
+        readFrames = 0;
+        prepareState = PrepareState::Ready;
+
+        streaming = false;
+        endOfStream = false;
+        loop = false;
+        streamState = StreamState::Streaming;
+        pendingSeek.reset();
+        underruns = 0;
+        stream.clear();
+
+        loopStart = 0;
+        loopEnd = 0;
+        crossfade = 0;
+
+        volume = 1.f;
+        normalization = 1.f;
+        effectiveVolume = 1.f;
+        fade = 1.f;
+        fadeTarget = 1.f;
+        fadeStep = 0.f;
+        fadeFrames = 0;
+        fadeAction = FadeAction::None;
+        fadeSeek = 0;
+        gain = 1.f;
+        rampFrames = 0;
+        paused = false;
+        repeat = false;
+        stopped = false;
+        finished = false;
+        playing = false;
+    }
+    Voice::~Voice()
+    {
+        reset();
+    }
     PlayingSound::PlayingSound(const PlayingSound &other)
     {
         if (&other == this)
@@ -445,16 +2607,12 @@ namespace Soundux::Objects
 
         id = other.id;
         sound = other.sound;
-        buffer = other.buffer;
 
-        seekTo.store(other.seekTo);
         paused.store(other.paused);
         repeat.store(other.repeat);
+        volume.store(other.volume);
         readInMs.store(other.readInMs);
-        shouldSeek.store(other.shouldSeek);
 
-        raw.device.store(other.raw.device);
-        raw.decoder.store(other.raw.decoder);
         playbackDevice = other.playbackDevice;
     }
     PlayingSound &PlayingSound::operator=(const PlayingSound &other)
@@ -471,16 +2629,12 @@ namespace Soundux::Objects
 
         id = other.id;
         sound = other.sound;
-        buffer = other.buffer;
 
-        seekTo.store(other.seekTo);
         paused.store(other.paused);
         repeat.store(other.repeat);
+        volume.store(other.volume);
         readInMs.store(other.readInMs);
-        shouldSeek.store(other.shouldSeek);
 
-        raw.device.store(other.raw.device);
-        raw.decoder.store(other.raw.decoder);
         playbackDevice = other.playbackDevice;
 
         return *this;
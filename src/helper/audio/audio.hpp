@@ -1,14 +1,21 @@
 #pragma once
+#include <array>
 #include <atomic>
 #include <core/objects/objects.hpp>
 #include <cstdint>
+#include <functional>
+#include <helper/audio/cache/cache.hpp>
+#include <helper/audio/dsp/dsp.hpp>
+#include <helper/ringbuffer/ringbuffer.hpp>
 #include <map>
 #include <memory>
 #include <miniaudio.h>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
 #include <var_guard.hpp>
+#include <vector>
 
 namespace Soundux
 {
@@ -20,53 +27,410 @@ namespace Soundux
             std::string name;
             bool isDefault;
         };
+        //* What the backend actually gave us for an output
+        struct OutputInfo
+        {
+            std::string name;
+            std::uint32_t sampleRate;
+            std::uint32_t periodSize; //* In frames
+            std::uint32_t periods;
+            double latency; //* In milliseconds
+            bool exclusive;
+
+            float gainReduction;          //* In dB, the most the limiter reduced since the last query
+            std::uint64_t limitedPeriods; //* Periods in which the limiter reduced the gain
+
+            std::uint64_t callbacks;
+            double callbackTime; //* In microseconds, averaged over all callbacks
+        };
+        //* Callback instrumentation of an output, every value counts from when the output was opened
+        struct OutputDiagnostics
+        {
+            std::string name;
+            std::uint64_t callbacks;
+            std::uint64_t underruns;
+            std::uint64_t deadlineMisses;
+            std::uint64_t framesRequested;
+            std::uint64_t framesStarved;
+
+            //* In microseconds
+            double deadline;
+            double averageCallback;
+            double worstCallback;
+
+            //* Bucket i counts the callbacks that took less than histogramStart * 2^i microseconds,
+            //* the last bucket counts everything above
+            std::uint64_t histogramStart;
+            std::vector<std::uint64_t> histogram;
+        };
         struct PlayingSound
         {
             AudioDevice playbackDevice;
 
-            struct
-            {
-                std::atomic<ma_device *> device;
-                std::atomic<ma_decoder *> decoder;
-            } raw;
-
             std::uint64_t length = 0;
             std::uint64_t lengthInMs = 0;
             std::uint64_t readFrames = 0;
             std::uint64_t sampleRate = 0;
 
+            std::atomic<float> volume = 1.f;
             std::atomic<bool> paused = false;
             std::atomic<bool> repeat = false;
-            std::atomic<bool> shouldSeek = false;
-            std::atomic<std::uint64_t> seekTo = 0;
             std::atomic<std::uint64_t> readInMs = 0;
 
             Sound sound;
             std::uint32_t id;
-            std::uint64_t buffer = 0;
 
             PlayingSound() = default;
             PlayingSound(const PlayingSound &);
             PlayingSound &operator=(const PlayingSound &other);
         };
+
+        struct DecoderSlot
+        {
+            ma_decoder decoder;
+            bool initialized = false;
+
+            //* Seek table the decoder was bound to, it has to outlive the decoder
+            std::shared_ptr<const void> seekTable;
+
+            //* Shared by every voice that reads from the decoder, so it doesn't matter which of them are left
+            std::atomic<std::uint64_t> seekRequest = 0;
+            std::uint64_t frame = 0; //* Position of the decoder, only touched by the decode worker
+            std::uint64_t loopStart = 0;
+            std::uint64_t loopEnd = 0;
+        };
+        struct Voice
+        {
+            std::atomic<std::uint32_t> id = 0;
+            std::uint64_t length = 0;
+
+            //* Voices that were not in the pcm cache are started right away and stay silent until the decode worker
+            //* decoded them into the cache or opened and primed their stream
+            enum class PrepareState : std::uint8_t
+            {
+                Ready,
+                Pending,
+                Failed, //* The file could not be opened, the audio thread finishes the voice
+            };
+            std::atomic<PrepareState> prepareState = PrepareState::Ready;
+
+            //* Set when the sound is played from the pcm cache
+            std::shared_ptr<const CachedSound> pcm;
+            std::uint64_t pcmFrame = 0;
+
+            //* Otherwise the sound is streamed, the decoder is only ever read by the decode worker
+            //* which keeps the stream filled ahead of the audio thread.
+            enum class StreamState : std::uint8_t
+            {
+                Streaming,
+                Seeking, //* Set by the audio thread, the worker seeks the decoder and stops writing
+                Seeked,  //* Set by the worker, the audio thread drops the stale samples and resumes
+            };
+
+            //* Voices of the same sound on outputs with the same format share one decoder
+            std::shared_ptr<DecoderSlot> decoder;
+            StreamRingBuffer<float> stream;
+            std::atomic<bool> streaming = false;
+            std::atomic<bool> endOfStream = false;
+            std::atomic<bool> loop = false;
+            std::atomic<StreamState> streamState = StreamState::Streaming;
+            std::optional<std::uint64_t> pendingSeek;
+            std::atomic<std::uint64_t> underruns = 0;
+            std::atomic<bool> decoding = false; //* Claimed by the decode worker, which works on it without any lock
+
+            //* Loop region in frames of the output, only used while repeating. An end of 0 loops the whole sound.
+            std::uint64_t loopStart = 0;
+            std::uint64_t loopEnd = 0;
+            std::uint64_t crossfade = 0;
+
+            //* Envelope that avoids clicks when the sound starts, stops, pauses or seeks. The action is carried
+            //* out once the envelope reached its target.
+            enum class FadeAction : std::uint8_t
+            {
+                None,
+                Stop,
+                Pause,
+                Seek,
+            };
+            float fade = 1.f;
+            float fadeTarget = 1.f;
+            float fadeStep = 0.f;
+            std::uint32_t fadeFrames = 0; //* Frames left until the target is reached
+            FadeAction fadeAction = FadeAction::None;
+            std::uint64_t fadeSeek = 0; //* In frames
+
+            //* Playback state as seen by the audio thread, only changed through commands
+            float volume = 1.f;
+            float normalization = 1.f;    //* Loudness correction, applied on top of every volume the voice gets
+            float gain = 1.f;             //* The gain that is currently applied, ramps towards the volume
+            std::uint32_t rampFrames = 0; //* Frames left until the gain reaches the volume
+            bool paused = false;
+            bool repeat = false;
+            bool stopped = false;
+            bool finished = false;
+            bool playing = false;
+
+            //* Written by the audio thread, read by everyone else
+            std::atomic<std::uint64_t> readFrames = 0;
+            std::atomic<float> effectiveVolume = 1.f; //* The volume the voice plays at, including the normalization
+
+            //* Whether the slot is handed out, only touched by control threads
+            bool used = false;
+
+            void reset();
+            ~Voice();
+        };
+        struct Command
+        {
+            enum class Type : std::uint8_t
+            {
+                Play,
+                Stop,
+                Seek,
+                Pause,
+                Resume,
+                Repeat,
+                Volume,
+            } type;
+
+            std::uint32_t id;
+            std::size_t slot;
+
+            union
+            {
+                std::uint64_t position = 0; //* In milliseconds, every output converts it with its own sample rate
+                float volume;
+                bool state;
+            };
+        };
+        struct Event
+        {
+            enum class Type : std::uint8_t
+            {
+                Finished,
+                Removed,
+            } type;
+
+            std::uint32_t id;
+            std::size_t slot;
+        };
+        struct Output
+        {
+            //* Scratch space a single voice is decoded into before it is mixed into the device buffer
+            static constexpr std::uint32_t scratchFrames = 4096;
+            static constexpr std::size_t maxVoices = 128;
+            //* Volume changes are spread over this many milliseconds to avoid clicks
+            static constexpr std::uint32_t volumeRampMs = 10;
+
+            //* How far the decode worker reads ahead of streaming voices and in which steps
+            static constexpr std::uint32_t streamFrames = 32768;
+            static constexpr std::uint32_t streamChunkFrames = 4096;
+
+            ma_device device;
+            AudioDevice playbackDevice;
+
+            //* Outputs are always rendered as f32
+            std::uint32_t channels = 2;
+            std::uint32_t sampleRate = 0;
+            std::uint32_t periodSize = 0; //* In frames of the device, which may run at a different rate
+            std::uint32_t periods = 0;
+            double latency = 0; //* In milliseconds
+            bool exclusive = false;
+
+            //* Set for outputs that are not driven by a miniaudio device, e.g. the native PipeWire stream
+            std::function<void()> close;
+
+            //* Commands may be sent from any thread, the mutex makes sure there is only ever one producer
+            std::mutex commandMutex;
+            RingBuffer<Command, 1024> commands;
+            RingBuffer<Event, 1024> events;
+
+            //* Voices are preallocated so that playing a sound never allocates on the audio thread
+            std::array<Voice, maxVoices> voices;
+
+            //* Only accessed from the audio thread
+            std::size_t activeVoices = 0;
+            std::array<std::size_t, maxVoices> active;
+            std::array<float, scratchFrames * 2> scratch;
+            Helpers::Limiter limiter;
+
+            //* Microphone samples that are mixed into this output, written by the capture device
+            StreamRingBuffer<float> input;
+            std::atomic<bool> inputActive = false;
+            Helpers::Ducker ducker;
+
+            std::atomic<std::uint32_t> fadeMs = 0; //* Length of the voice envelopes
+
+            std::atomic<std::uint64_t> underruns = 0;
+            std::atomic<float> gainReduction = 0.f;
+            std::atomic<std::uint64_t> limitedPeriods = 0;
+
+            //* Instrumentation of the callback, only written by the audio thread
+            static constexpr std::size_t histogramSize = 12;
+            static constexpr std::uint64_t histogramStart = 32; //* In microseconds, every further bucket doubles
+
+            std::atomic<std::uint64_t> callbacks = 0;
+            std::atomic<std::uint64_t> callbackTime = 0;    //* In nanoseconds, summed up over all callbacks
+            std::atomic<std::uint64_t> worstCallback = 0;   //* In nanoseconds
+            std::atomic<std::uint64_t> deadline = 0;        //* In nanoseconds, the length of the last period
+            std::atomic<std::uint64_t> deadlineMisses = 0;  //* Callbacks that took longer than the audio they rendered
+            std::atomic<std::uint64_t> framesRequested = 0; //* Frames the device asked for
+            std::atomic<std::uint64_t> framesStarved = 0;   //* Frames streamed voices couldn't deliver in time
+            std::array<std::atomic<std::uint64_t>, histogramSize> histogram{};
+
+            //* When a period with sound followed a silent one, in nanoseconds of the steady clock
+            std::atomic<std::int64_t> audibleAt = 0;
+            bool audible = false; //* Only touched by the audio thread
+        };
+        //* Precomputed seek points of a file, so that seeking a streamed sound doesn't decode from the start
+        struct SeekTable
+        {
+            std::uint64_t modifiedDate;
+            std::shared_ptr<const void> points; //* The format depends on the decoder
+        };
+        struct VoiceHandle
+        {
+            Output *output;
+            std::size_t slot;
+            bool remote;
+        };
+        //* All voices that play one sound, every output gets its own voice but they are controlled together
+        struct VoiceGroup
+        {
+            std::vector<VoiceHandle> voices;
+            bool finished = false;
+        };
+        //* Voices of a sound that the decode worker still has to prepare
+        struct Preparation
+        {
+            Sound sound;
+            std::uint32_t id;
+            std::vector<VoiceHandle> voices;
+        };
         class Audio
         {
             sxl::var_guard<std::map<std::uint32_t, std::shared_ptr<PlayingSound>>, std::recursive_mutex> playingSounds;
+            sxl::var_guard<std::map<std::string, std::unique_ptr<Output>>, std::recursive_mutex> outputs;
+            AudioDevice defaultPlayback; //* Guarded by outputs
+            SoundCache cache;
+            std::uint32_t sampleRate = 0; //* The rate every output runs at
+
+            //* Maps a sound to its voice slots, slots are released once the audio thread reports them as done
+            sxl::var_guard<std::map<std::uint32_t, VoiceGroup>> voices;
+
+            //* Entries of both pools are free once the pool holds the only reference to them, streamed sounds get their
+            //* decoder from the fixed pool instead of allocating one every time
+            sxl::var_guard<std::vector<std::shared_ptr<DecoderSlot>>> decoderPool;
+            std::vector<std::shared_ptr<PlayingSound>> soundPool; //* Guarded by playingSounds
+            sxl::var_guard<std::map<std::string, SeekTable>> seekTables;
+
+            //* Opening a file, probing its length and decoding the first chunk all happen on the decode worker
+            sxl::var_guard<std::vector<Preparation>> preparations;
+
+            //* One context for the whole session, the device list is only enumerated again when it changed
+            ma_context context;
+            bool hasContext = false;
+            sxl::var_guard<std::vector<AudioDevice>> devices;
+
+            std::thread dispatcher;
+            std::thread streamer;
+            std::atomic<bool> running = false;
+            bool nullBackend = false;
+            std::shared_ptr<std::atomic<bool>> diagnosticsTimer;
+
+            Output *getOutput(const AudioDevice &);
+            void closeOutput(const std::string &);
+            void closeOutputs();
+            void switchDefaultPlayback(const AudioDevice &);
+            AudioDevice getDefaultPlayback();
+#if defined(__linux__)
+            std::optional<AudioDevice> openStreamOutput();
+
+            //* Captures the microphone into the remote output, so it can be ducked without a server round trip
+            std::unique_ptr<ma_device> microphone;
+            void closeMicrophone();
+#endif
+
+            bool send(const Command &, std::optional<bool> remote = std::nullopt);
+            bool send(Output *, const Command &);
 
-            void onFinished(PlayingSound);
-            void onSoundSeeked(PlayingSound *, std::uint64_t);
-            void onSoundProgressed(PlayingSound *, std::uint64_t);
+            std::optional<std::size_t> acquireVoice(Output *);
+            void releaseVoice(Output *, std::size_t);
+            std::shared_ptr<DecoderSlot> createDecoder(const Sound &, std::uint32_t, std::uint32_t);
+            void recycleDecoders();
+            void bindSeekTable(const Sound &, DecoderSlot &);
+            void buildSeekTable(const Sound &);
 
+            std::optional<Metadata> probe(const Sound &);
+            std::optional<Loudness> measureLoudness(const Sound &);
+            static float getNormalization(const Sound &);
+
+            std::shared_ptr<PlayingSound> acquireSound(); //* Null once every pooled sound is playing
+            bool stealVoice(const Sound &);
+
+            void dispatch();
+            void dispatchEvents();
+            void dispatchProgress();
+            void logDiagnostics();
+            void updateProgress(PlayingSound &);
+
+            void stream();
+            void prepare(const Preparation &, float *);
+            static bool fillStream(const std::vector<Voice *> &, std::uint32_t, float *);
+            static void applyLoop(Voice &, const Sound &, std::uint32_t);
+
+            void onFinished(const std::uint32_t &);
+
+            static void mix(Output *, Voice *, float *, std::uint32_t);
+            static void seekVoice(Voice *, std::uint64_t);
+            static void fadeVoice(Voice *, float, std::uint32_t, Voice::FadeAction);
+            static void finishFade(Voice *, std::uint32_t);
+            static std::uint64_t wrapLoop(const Voice *, std::uint64_t);
+            static void mixInput(Output *, float *, std::uint32_t);
+            static void render(Output *, float *, std::uint32_t);
             static void data_callback(ma_device *device, void *output, const void *input, std::uint32_t frameCount);
+            static void capture_callback(ma_device *device, void *output, const void *input, std::uint32_t frameCount);
 
           public:
+            //* Stolen voices keep their slots until the audio thread let go of them, so only half of them can play
+            static constexpr std::uint32_t maxSounds = Output::maxVoices / 2;
+            //* The voice limit of the settings clamped to what the outputs can play, logs when it had to be clamped
+            static std::uint32_t clampMaxVoices(std::uint32_t);
+
             std::optional<PlayingSound> pause(const std::uint32_t &);
             std::optional<PlayingSound> resume(const std::uint32_t &);
             std::optional<PlayingSound> repeat(const std::uint32_t &, bool);
             std::optional<PlayingSound> seek(const std::uint32_t &, std::uint64_t);
+            bool setLocalVolume(const std::uint32_t &, float);
+            bool setRemoteVolume(const std::uint32_t &, float);
+
+            //* Plays the sound on the default device and, if given, on the remote device from the same decoder
             std::optional<PlayingSound> play(const Objects::Sound &, const std::optional<AudioDevice> & = std::nullopt);
 
+            void preload(const std::vector<Sound> &);
+            //* Probes the metadata and measures the loudness of sounds that weren't analyzed yet, one sound at a time
+            //* in the background
+            void analyze(const std::vector<Sound> &);
+            void setCacheSize(std::uint32_t);
+            void setStreamThreshold(std::uint32_t);
+            void updateLimiter();
+            void setFadeDuration(std::uint32_t);
+
+            std::uint64_t getUnderruns();
+            std::vector<OutputInfo> getOutputInfo();
+            std::vector<OutputDiagnostics> getDiagnostics();
+            //* The last time any output went from silence to sound, in nanoseconds of the steady clock
+            std::int64_t getAudibleAt();
+
+            //* Only meant for benchmarks, opens every device on miniaudio's null backend. Call it before setup.
+            void useNullBackend();
+
+            //* Returns the cached devices, they are only enumerated on the first call and when refreshed
             std::vector<AudioDevice> getAudioDevices();
+            std::vector<AudioDevice> refreshDevices();
+            //* Called by the backends when a device was added, removed or the default changed, may be called from
+            //* any thread. The refresh itself happens on the queue.
+            void onDevicesChanged();
             std::vector<Objects::PlayingSound> getPlayingSounds();
 
 #if defined(_WIN32)
@@ -80,9 +444,13 @@ namespace Soundux
             bool stop(const std::uint32_t &);
 
 #if defined(__linux__)
+            void setStreamQuantum(std::uint32_t);
+
+            //* Opens or closes the microphone capture according to the settings
+            void updateDucking();
+            bool isDucking();
             std::optional<AudioDevice> nullSink;
 #endif
-            AudioDevice defaultPlayback;
         };
     } // namespace Objects
-} // namespace Soundux
\ No newline at end of file
+} // namespace Soundux
@@ -0,0 +1,207 @@
+#include "cache.hpp"
+#include <fancy.hpp>
+#include <helper/audio/dsp/dsp.hpp>
+#include <miniaudio.h>
+#if defined(_WIN32)
+#include <helper/misc/misc.hpp>
+#endif
+
+namespace Soundux::Objects
+{
+    std::size_t CachedSound::size() const
+    {
+        return data.size() * sizeof(float);
+    }
+    std::shared_ptr<const CachedSound> SoundCache::get(const Sound &sound, std::uint32_t channels,
+                                                       std::uint32_t sampleRate)
+    {
+        std::lock_guard lock(cacheMutex);
+
+        auto key = std::make_pair(sound.path, sampleRate);
+        if (index.find(key) == index.end())
+        {
+            return nullptr;
+        }
+
+        auto it = index.at(key);
+        if ((*it)->modifiedDate != sound.modifiedDate || (*it)->channels != channels)
+        {
+            erase(key);
+            return nullptr;
+        }
+
+        entries.splice(entries.begin(), entries, it);
+        return *it;
+    }
+    std::shared_ptr<const CachedSound> SoundCache::load(const Sound &sound, std::uint32_t channels,
+                                                        std::uint32_t sampleRate)
+    {
+        if (auto cached = get(sound, channels, sampleRate); cached)
+        {
+            return cached;
+        }
+        if (!fits(sound, channels, sampleRate))
+        {
+            return nullptr;
+        }
+
+        //* Decode at the native rate of the file, resampling is done by us in the quality that was chosen
+        ma_decoder decoder;
+        auto config = ma_decoder_config_init(ma_format_f32, channels, 0);
+#if defined(_WIN32)
+        auto res = ma_decoder_init_file_w(Helpers::widen(sound.path).c_str(), &config, &decoder);
+#else
+        auto res = ma_decoder_init_file(sound.path.c_str(), &config, &decoder);
+#endif
+
+        if (res != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().warning() << "Failed to create decoder for caching " << sound.path << ", error: " >>
+                res << std::endl;
+            return nullptr;
+        }
+
+        auto cached = std::make_shared<CachedSound>();
+        cached->path = sound.path;
+        cached->channels = channels;
+        cached->sampleRate = sampleRate;
+        cached->modifiedDate = sound.modifiedDate;
+
+        const auto nativeRate = decoder.outputSampleRate;
+        cached->sourceRate = nativeRate;
+        //* Getting the length may scan the whole file, so it is done before locking to not hold up get()
+        const auto frames = ma_decoder_get_length_in_pcm_frames(&decoder);
+        const auto expectedSize =
+            ma_calculate_frame_count_after_resampling(sampleRate, nativeRate, frames) * channels * sizeof(float);
+
+        auto resampleQuality = Enums::ResampleQuality::Sinc;
+        {
+            std::lock_guard lock(cacheMutex);
+            resampleQuality = quality;
+
+            if (expectedSize > budget || (maxEntrySize && expectedSize > maxEntrySize))
+            {
+                tooBig.insert_or_assign(std::make_pair(sound.path, sampleRate), sound.modifiedDate);
+                ma_decoder_uninit(&decoder);
+                return nullptr;
+            }
+        }
+        cached->data.reserve(frames * channels);
+
+        constexpr std::uint64_t chunkFrames = 4096;
+        while (true)
+        {
+            auto offset = cached->data.size();
+            cached->data.resize(offset + chunkFrames * channels);
+
+            auto readFrames = ma_decoder_read_pcm_frames(&decoder, cached->data.data() + offset, chunkFrames);
+            cached->data.resize(offset + readFrames * channels);
+
+            if (readFrames < chunkFrames)
+            {
+                break;
+            }
+        }
+        ma_decoder_uninit(&decoder);
+
+        if (nativeRate != sampleRate)
+        {
+            cached->data = Helpers::resample(cached->data, channels, nativeRate, sampleRate, resampleQuality);
+        }
+
+        cached->data.shrink_to_fit();
+        cached->frames = cached->data.size() / channels;
+
+        std::lock_guard lock(cacheMutex);
+        auto key = std::make_pair(sound.path, sampleRate);
+        if (index.find(key) != index.end())
+        {
+            erase(key);
+        }
+
+        if (cached->size() > budget || (maxEntrySize && cached->size() > maxEntrySize))
+        {
+            tooBig.insert_or_assign(key, sound.modifiedDate);
+            return cached;
+        }
+
+        entries.emplace_front(cached);
+        index.emplace(key, entries.begin());
+        usedBytes += cached->size();
+
+        evict();
+        return cached;
+    }
+    bool SoundCache::fits(const Sound &sound, std::uint32_t channels, std::uint32_t sampleRate)
+    {
+        std::lock_guard lock(cacheMutex);
+        return !isTooBig(sound, channels, sampleRate);
+    }
+    bool SoundCache::isTooBig(const Sound &sound, std::uint32_t channels, std::uint32_t sampleRate) const
+    {
+        //* A file that changed may have gotten smaller
+        if (auto it = tooBig.find(std::make_pair(sound.path, sampleRate));
+            it != tooBig.end() && it->second == sound.modifiedDate)
+        {
+            return true;
+        }
+        if (sound.metadata && sound.metadata->sampleRate)
+        {
+            const auto expectedSize = ma_calculate_frame_count_after_resampling(sampleRate, sound.metadata->sampleRate,
+                                                                                sound.metadata->frames) *
+                                      channels * sizeof(float);
+
+            return expectedSize > budget || (maxEntrySize && expectedSize > maxEntrySize);
+        }
+
+        return false;
+    }
+    void SoundCache::erase(const Key &key)
+    {
+        auto it = index.at(key);
+        usedBytes -= (*it)->size();
+
+        entries.erase(it);
+        index.erase(key);
+    }
+    void SoundCache::evict()
+    {
+        while (usedBytes > budget && !entries.empty())
+        {
+            const auto &last = entries.back();
+            erase(std::make_pair(last->path, last->sampleRate));
+        }
+    }
+    void SoundCache::setBudget(std::size_t bytes)
+    {
+        std::lock_guard lock(cacheMutex);
+        budget = bytes;
+        tooBig.clear();
+        evict();
+    }
+    void SoundCache::setMaxEntrySize(std::size_t bytes)
+    {
+        std::lock_guard lock(cacheMutex);
+        maxEntrySize = bytes;
+        tooBig.clear();
+    }
+    void SoundCache::setResampleQuality(Enums::ResampleQuality newQuality)
+    {
+        std::lock_guard lock(cacheMutex);
+        if (quality != newQuality)
+        {
+            //* Entries are only ever resampled once, so the old ones would keep their quality
+            quality = newQuality;
+            entries.clear();
+            index.clear();
+            usedBytes = 0;
+        }
+    }
+    void SoundCache::clear()
+    {
+        std::lock_guard lock(cacheMutex);
+        entries.clear();
+        index.clear();
+        usedBytes = 0;
+    }
+} // namespace Soundux::Objects
@@ -0,0 +1,66 @@
+#pragma once
+#include <core/enums/enums.hpp>
+#include <core/objects/objects.hpp>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Soundux
+{
+    namespace Objects
+    {
+        struct CachedSound
+        {
+            std::string path;
+            std::uint64_t modifiedDate;
+
+            std::uint64_t frames = 0;
+            std::uint32_t channels = 0;
+            std::uint32_t sampleRate = 0;
+            std::uint32_t sourceRate = 0; //* The rate of the file before it was resampled
+
+            //* Interleaved f32 pcm, voices read directly from it
+            std::vector<float> data;
+
+            std::size_t size() const;
+        };
+
+        class SoundCache
+        {
+            using Key = std::pair<std::string, std::uint32_t>;
+
+            std::mutex cacheMutex;
+            std::list<std::shared_ptr<const CachedSound>> entries; //* Most recently used first
+            std::map<Key, std::list<std::shared_ptr<const CachedSound>>::iterator> index;
+
+            std::size_t budget = 0;
+            std::size_t usedBytes = 0;
+            std::size_t maxEntrySize = 0; //* Bigger sounds are streamed instead, 0 means no limit
+            //* The modifiedDate of sounds that turned out too big, so they are not decoded again on every preload
+            std::map<Key, std::uint64_t> tooBig;
+
+            //* Sounds are decoded at their own rate and resampled once when they are loaded
+            Enums::ResampleQuality quality = Enums::ResampleQuality::Sinc;
+
+          private:
+            void evict();
+            void erase(const Key &);
+            bool isTooBig(const Sound &, std::uint32_t, std::uint32_t) const; //* Expects cacheMutex to be locked
+
+          public:
+            std::shared_ptr<const CachedSound> get(const Sound &, std::uint32_t, std::uint32_t);
+            std::shared_ptr<const CachedSound> load(const Sound &, std::uint32_t, std::uint32_t);
+            //* False if the sound is known to be streamed anyway, by its metadata or an earlier load
+            bool fits(const Sound &, std::uint32_t, std::uint32_t);
+
+            void clear();
+            void setBudget(std::size_t);
+            void setMaxEntrySize(std::size_t);
+            void setResampleQuality(Enums::ResampleQuality);
+        };
+    } // namespace Objects
+} // namespace Soundux
@@ -0,0 +1,431 @@
+#include "dsp.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SOUNDUX_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SOUNDUX_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SOUNDUX_TARGET(isa)
+#endif
+
+namespace Soundux::Helpers
+{
+    namespace
+    {
+        constexpr float s16Scale = 1.f / 32768.f;
+
+        void mixScalar(float *dst, const float *src, std::size_t frames, float start, float step,
+                       std::size_t offset = 0)
+        {
+            for (auto i = offset; frames > i; i++)
+            {
+                const auto gain = start + step * static_cast<float>(i);
+                dst[i * 2] += src[i * 2] * gain;
+                dst[i * 2 + 1] += src[i * 2 + 1] * gain;
+            }
+        }
+        void mixScalar(float *dst, const std::int16_t *src, std::size_t frames, float start, float step,
+                       std::size_t offset = 0)
+        {
+            for (auto i = offset; frames > i; i++)
+            {
+                const auto gain = (start + step * static_cast<float>(i)) * s16Scale;
+                dst[i * 2] += static_cast<float>(src[i * 2]) * gain;
+                dst[i * 2 + 1] += static_cast<float>(src[i * 2 + 1]) * gain;
+            }
+        }
+
+        void peakScalar(const float *src, float *peaks, std::size_t frames, std::size_t offset = 0)
+        {
+            for (auto i = offset; frames > i; i++)
+            {
+                peaks[i] = std::max(std::abs(src[i * 2]), std::abs(src[i * 2 + 1]));
+            }
+        }
+        void gainScalar(float *samples, const float *gains, std::size_t frames, std::size_t offset = 0)
+        {
+            for (auto i = offset; frames > i; i++)
+            {
+                samples[i * 2] *= gains[i];
+                samples[i * 2 + 1] *= gains[i];
+            }
+        }
+
+        //* Pade approximation of tanh, exact at 0 and reaching 1 at 3 where the input is clamped
+        constexpr float clipRange = 3.f;
+
+        void clipScalar(float *samples, std::size_t count, float knee, float ceiling, std::size_t offset = 0)
+        {
+            const auto scale = 1.f / (ceiling - knee);
+            for (auto i = offset; count > i; i++)
+            {
+                const auto magnitude = std::abs(samples[i]);
+                if (magnitude > knee)
+                {
+                    const auto t = std::min((magnitude - knee) * scale, clipRange);
+                    const auto bent = knee + (ceiling - knee) * t * (27.f + t * t) / (27.f + 9.f * t * t);
+                    samples[i] = std::copysign(bent, samples[i]);
+                }
+            }
+        }
+
+#if defined(SOUNDUX_X86)
+        //* Two stereo frames per vector
+        SOUNDUX_TARGET("sse2")
+        void mixSSE2(float *dst, const float *src, std::size_t frames, float start, float step)
+        {
+            const auto offsets = _mm_set_ps(step, step, 0.f, 0.f);
+
+            std::size_t i = 0;
+            for (; frames >= i + 2; i += 2)
+            {
+                const auto gain = _mm_add_ps(_mm_set1_ps(start + step * static_cast<float>(i)), offsets);
+                const auto mixed = _mm_add_ps(_mm_loadu_ps(dst + i * 2), _mm_mul_ps(_mm_loadu_ps(src + i * 2), gain));
+                _mm_storeu_ps(dst + i * 2, mixed);
+            }
+
+            mixScalar(dst, src, frames, start, step, i);
+        }
+        SOUNDUX_TARGET("sse2")
+        void mixSSE2(float *dst, const std::int16_t *src, std::size_t frames, float start, float step)
+        {
+            const auto scale = _mm_set1_ps(s16Scale);
+            const auto offsets = _mm_set_ps(step, step, 0.f, 0.f);
+
+            std::size_t i = 0;
+            for (; frames >= i + 2; i += 2)
+            {
+                auto samples = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i * 2));
+                samples = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+
+                const auto gain = _mm_add_ps(_mm_set1_ps(start + step * static_cast<float>(i)), offsets);
+                const auto source = _mm_mul_ps(_mm_cvtepi32_ps(samples), scale);
+
+                _mm_storeu_ps(dst + i * 2, _mm_add_ps(_mm_loadu_ps(dst + i * 2), _mm_mul_ps(source, gain)));
+            }
+
+            mixScalar(dst, src, frames, start, step, i);
+        }
+        SOUNDUX_TARGET("sse2")
+        void peakSSE2(const float *src, float *peaks, std::size_t frames)
+        {
+            const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+            std::size_t i = 0;
+            for (; frames >= i + 2; i += 2)
+            {
+                const auto magnitude = _mm_and_ps(_mm_loadu_ps(src + i * 2), absMask);
+                const auto louder = _mm_max_ps(magnitude, _mm_shuffle_ps(magnitude, magnitude, _MM_SHUFFLE(2, 3, 0, 1)));
+                _mm_storel_pi(reinterpret_cast<__m64 *>(peaks + i),
+                              _mm_shuffle_ps(louder, louder, _MM_SHUFFLE(2, 0, 2, 0)));
+            }
+
+            peakScalar(src, peaks, frames, i);
+        }
+        SOUNDUX_TARGET("sse2")
+        void gainSSE2(float *samples, const float *gains, std::size_t frames)
+        {
+            std::size_t i = 0;
+            for (; frames >= i + 2; i += 2)
+            {
+                auto gain = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(gains + i)));
+                gain = _mm_unpacklo_ps(gain, gain);
+                _mm_storeu_ps(samples + i * 2, _mm_mul_ps(_mm_loadu_ps(samples + i * 2), gain));
+            }
+
+            gainScalar(samples, gains, frames, i);
+        }
+        SOUNDUX_TARGET("sse2")
+        void clipSSE2(float *samples, std::size_t count, float knee, float ceiling)
+        {
+            const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            const auto vKnee = _mm_set1_ps(knee);
+            const auto vRange = _mm_set1_ps(ceiling - knee);
+            const auto vScale = _mm_set1_ps(1.f / (ceiling - knee));
+            const auto vClamp = _mm_set1_ps(clipRange);
+
+            std::size_t i = 0;
+            for (; count >= i + 4; i += 4)
+            {
+                const auto sample = _mm_loadu_ps(samples + i);
+                const auto magnitude = _mm_and_ps(sample, absMask);
+                const auto above = _mm_cmpgt_ps(magnitude, vKnee);
+                if (_mm_movemask_ps(above) == 0)
+                {
+                    continue;
+                }
+
+                const auto t = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(magnitude, vKnee), vScale), vClamp);
+                const auto t2 = _mm_mul_ps(t, t);
+                const auto numerator = _mm_mul_ps(t, _mm_add_ps(_mm_set1_ps(27.f), t2));
+                const auto denominator = _mm_add_ps(_mm_set1_ps(27.f), _mm_mul_ps(_mm_set1_ps(9.f), t2));
+                const auto bent = _mm_add_ps(vKnee, _mm_mul_ps(vRange, _mm_div_ps(numerator, denominator)));
+
+                const auto shaped = _mm_or_ps(_mm_and_ps(above, bent), _mm_andnot_ps(above, magnitude));
+                _mm_storeu_ps(samples + i, _mm_or_ps(shaped, _mm_andnot_ps(absMask, sample)));
+            }
+
+            clipScalar(samples, count, knee, ceiling, i);
+        }
+
+        //* Four stereo frames per vector
+        SOUNDUX_TARGET("avx2")
+        void mixAVX2(float *dst, const float *src, std::size_t frames, float start, float step)
+        {
+            const auto offsets = _mm256_set_ps(step * 3, step * 3, step * 2, step * 2, step, step, 0.f, 0.f);
+
+            std::size_t i = 0;
+            for (; frames >= i + 4; i += 4)
+            {
+                const auto gain = _mm256_add_ps(_mm256_set1_ps(start + step * static_cast<float>(i)), offsets);
+                const auto mixed =
+                    _mm256_add_ps(_mm256_loadu_ps(dst + i * 2), _mm256_mul_ps(_mm256_loadu_ps(src + i * 2), gain));
+                _mm256_storeu_ps(dst + i * 2, mixed);
+            }
+
+            mixScalar(dst, src, frames, start, step, i);
+        }
+        SOUNDUX_TARGET("avx2")
+        void mixAVX2(float *dst, const std::int16_t *src, std::size_t frames, float start, float step)
+        {
+            const auto scale = _mm256_set1_ps(s16Scale);
+            const auto offsets = _mm256_set_ps(step * 3, step * 3, step * 2, step * 2, step, step, 0.f, 0.f);
+
+            std::size_t i = 0;
+            for (; frames >= i + 4; i += 4)
+            {
+                const auto samples =
+                    _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2)));
+
+                const auto gain = _mm256_add_ps(_mm256_set1_ps(start + step * static_cast<float>(i)), offsets);
+                const auto source = _mm256_mul_ps(_mm256_cvtepi32_ps(samples), scale);
+
+                _mm256_storeu_ps(dst + i * 2, _mm256_add_ps(_mm256_loadu_ps(dst + i * 2), _mm256_mul_ps(source, gain)));
+            }
+
+            mixScalar(dst, src, frames, start, step, i);
+        }
+        SOUNDUX_TARGET("avx2")
+        void peakAVX2(const float *src, float *peaks, std::size_t frames)
+        {
+            const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+            const auto evens = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+            std::size_t i = 0;
+            for (; frames >= i + 4; i += 4)
+            {
+                const auto magnitude = _mm256_and_ps(_mm256_loadu_ps(src + i * 2), absMask);
+                const auto louder = _mm256_max_ps(magnitude, _mm256_permute_ps(magnitude, _MM_SHUFFLE(2, 3, 0, 1)));
+                _mm_storeu_ps(peaks + i, _mm256_castps256_ps128(_mm256_permutevar8x32_ps(louder, evens)));
+            }
+
+            peakScalar(src, peaks, frames, i);
+        }
+        SOUNDUX_TARGET("avx2")
+        void gainAVX2(float *samples, const float *gains, std::size_t frames)
+        {
+            const auto spread = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+            std::size_t i = 0;
+            for (; frames >= i + 4; i += 4)
+            {
+                const auto gain = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(gains + i)), spread);
+                _mm256_storeu_ps(samples + i * 2, _mm256_mul_ps(_mm256_loadu_ps(samples + i * 2), gain));
+            }
+
+            gainScalar(samples, gains, frames, i);
+        }
+        SOUNDUX_TARGET("avx2")
+        void clipAVX2(float *samples, std::size_t count, float knee, float ceiling)
+        {
+            const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+            const auto vKnee = _mm256_set1_ps(knee);
+            const auto vRange = _mm256_set1_ps(ceiling - knee);
+            const auto vScale = _mm256_set1_ps(1.f / (ceiling - knee));
+            const auto vClamp = _mm256_set1_ps(clipRange);
+
+            std::size_t i = 0;
+            for (; count >= i + 8; i += 8)
+            {
+                const auto sample = _mm256_loadu_ps(samples + i);
+                const auto magnitude = _mm256_and_ps(sample, absMask);
+                const auto above = _mm256_cmp_ps(magnitude, vKnee, _CMP_GT_OQ);
+                if (_mm256_movemask_ps(above) == 0)
+                {
+                    continue;
+                }
+
+                const auto t = _mm256_min_ps(_mm256_mul_ps(_mm256_sub_ps(magnitude, vKnee), vScale), vClamp);
+                const auto t2 = _mm256_mul_ps(t, t);
+                const auto numerator = _mm256_mul_ps(t, _mm256_add_ps(_mm256_set1_ps(27.f), t2));
+                const auto denominator = _mm256_add_ps(_mm256_set1_ps(27.f), _mm256_mul_ps(_mm256_set1_ps(9.f), t2));
+                const auto bent = _mm256_add_ps(vKnee, _mm256_mul_ps(vRange, _mm256_div_ps(numerator, denominator)));
+
+                const auto shaped = _mm256_blendv_ps(magnitude, bent, above);
+                _mm256_storeu_ps(samples + i, _mm256_or_ps(shaped, _mm256_andnot_ps(absMask, sample)));
+            }
+
+            clipScalar(samples, count, knee, ceiling, i);
+        }
+#endif
+
+        SimdLevel detect()
+        {
+#if defined(SOUNDUX_X86)
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return SimdLevel::AVX2;
+            }
+            if (__builtin_cpu_supports("sse2"))
+            {
+                return SimdLevel::SSE2;
+            }
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+
+            //* AVX2 also needs the os to save the ymm registers
+            const bool sse2 = (info[3] & (1 << 26)) != 0;
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+            if (osxsave && (_xgetbv(0) & 6) == 6)
+            {
+                __cpuidex(info, 7, 0);
+                if ((info[1] & (1 << 5)) != 0)
+                {
+                    return SimdLevel::AVX2;
+                }
+            }
+            if (sse2)
+            {
+                return SimdLevel::SSE2;
+            }
+#endif
+#endif
+            return SimdLevel::Scalar;
+        }
+
+        const SimdLevel supported = detect();
+        SimdLevel level = supported;
+    } // namespace
+
+    SimdLevel getSimdLevel()
+    {
+        return level;
+    }
+    SimdLevel getSupportedSimdLevel()
+    {
+        return supported;
+    }
+    void setSimdLevel(SimdLevel newLevel)
+    {
+        if (newLevel <= supported)
+        {
+            level = newLevel;
+        }
+    }
+    void mixStereo(float *dst, const float *src, std::size_t frames, float start, float end)
+    {
+        const auto step = frames > 0 ? (end - start) / static_cast<float>(frames) : 0.f;
+
+        switch (level)
+        {
+#if defined(SOUNDUX_X86)
+        case SimdLevel::AVX2:
+            mixAVX2(dst, src, frames, start, step);
+            break;
+        case SimdLevel::SSE2:
+            mixSSE2(dst, src, frames, start, step);
+            break;
+#endif
+        default:
+            mixScalar(dst, src, frames, start, step);
+            break;
+        }
+    }
+    void mixStereo(float *dst, const std::int16_t *src, std::size_t frames, float start, float end)
+    {
+        const auto step = frames > 0 ? (end - start) / static_cast<float>(frames) : 0.f;
+
+        switch (level)
+        {
+#if defined(SOUNDUX_X86)
+        case SimdLevel::AVX2:
+            mixAVX2(dst, src, frames, start, step);
+            break;
+        case SimdLevel::SSE2:
+            mixSSE2(dst, src, frames, start, step);
+            break;
+#endif
+        default:
+            mixScalar(dst, src, frames, start, step);
+            break;
+        }
+    }
+    void peakStereo(const float *src, float *peaks, std::size_t frames)
+    {
+        switch (level)
+        {
+#if defined(SOUNDUX_X86)
+        case SimdLevel::AVX2:
+            peakAVX2(src, peaks, frames);
+            break;
+        case SimdLevel::SSE2:
+            peakSSE2(src, peaks, frames);
+            break;
+#endif
+        default:
+            peakScalar(src, peaks, frames);
+            break;
+        }
+    }
+    void applyGain(float *samples, const float *gains, std::size_t frames)
+    {
+        switch (level)
+        {
+#if defined(SOUNDUX_X86)
+        case SimdLevel::AVX2:
+            gainAVX2(samples, gains, frames);
+            break;
+        case SimdLevel::SSE2:
+            gainSSE2(samples, gains, frames);
+            break;
+#endif
+        default:
+            gainScalar(samples, gains, frames);
+            break;
+        }
+    }
+    void softClip(float *samples, std::size_t count, float knee, float ceiling)
+    {
+        if (ceiling <= knee)
+        {
+            return;
+        }
+
+        switch (level)
+        {
+#if defined(SOUNDUX_X86)
+        case SimdLevel::AVX2:
+            clipAVX2(samples, count, knee, ceiling);
+            break;
+        case SimdLevel::SSE2:
+            clipSSE2(samples, count, knee, ceiling);
+            break;
+#endif
+        default:
+            clipScalar(samples, count, knee, ceiling);
+            break;
+        }
+    }
+} // namespace Soundux::Helpers
@@ -0,0 +1,138 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <core/enums/enums.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Soundux
+{
+    namespace Helpers
+    {
+        enum class SimdLevel : std::uint8_t
+        {
+            Scalar,
+            SSE2,
+            AVX2,
+        };
+
+        //* The best level supported by the cpu is picked on startup
+        SimdLevel getSimdLevel();
+        SimdLevel getSupportedSimdLevel();
+        //* Only meant for benchmarks, levels the cpu doesn't support are ignored
+        void setSimdLevel(SimdLevel);
+
+        //* Adds interleaved stereo frames from src onto dst. The gain ramps linearly from start towards end over
+        //* the given frames, pass the same value twice for a constant gain.
+        void mixStereo(float *dst, const float *src, std::size_t frames, float start, float end);
+        void mixStereo(float *dst, const std::int16_t *src, std::size_t frames, float start, float end);
+
+        //* Writes the louder absolute sample of every interleaved stereo frame to peaks
+        void peakStereo(const float *src, float *peaks, std::size_t frames);
+        //* Multiplies every interleaved stereo frame with its own gain
+        void applyGain(float *samples, const float *gains, std::size_t frames);
+        //* Leaves samples below the knee untouched and bends everything above it smoothly towards the ceiling
+        void softClip(float *samples, std::size_t count, float knee, float ceiling);
+
+        //* Converts interleaved f32 pcm to another sample rate. This is far too slow for the audio thread,
+        //* it is meant for preparing sounds before they are played.
+        std::vector<float> resample(const std::vector<float> &, std::uint32_t channels, std::uint32_t from,
+                                    std::uint32_t to, Enums::ResampleQuality);
+
+        //* Measures the integrated loudness (EBU R128) and the true peak of interleaved f32 pcm.
+        //* The samples can be fed in chunks of any size, so a sound never has to be decoded at once.
+        class LoudnessMeter
+        {
+            std::uint32_t channels;
+            std::uint32_t stepFrames; //* 100 ms, four steps make up one gating block
+
+            //* K-weighting, a high shelf followed by a high pass
+            std::array<double, 5> shelf;
+            std::array<double, 5> highPass;
+            std::vector<double> filterState; //* Four values per channel
+
+            std::vector<double> weights;
+            double stepEnergy = 0;
+            std::uint32_t stepPosition = 0;
+            std::vector<double> steps; //* Weighted mean square of every finished step
+
+            //* The last samples of every channel, used to oversample the signal for the true peak
+            std::vector<float> history;
+            std::size_t historyPosition = 0;
+            float peak = 0;
+
+          public:
+            LoudnessMeter(std::uint32_t channels, std::uint32_t sampleRate);
+
+            void process(const float *, std::size_t frames);
+
+            //* Both are -inf for silence
+            double getIntegrated() const; //* In LUFS
+            double getTruePeak() const;   //* In dBTP
+        };
+
+        //* Lookahead peak limiter for interleaved stereo, followed by a soft clipper that catches what is left.
+        //* All buffers are sized for the highest supported sample rate, so it never allocates on the audio thread.
+        class Limiter
+        {
+          public:
+            static constexpr std::uint32_t lookaheadMs = 5;
+            static constexpr std::uint32_t maxSampleRate = 384000;
+
+          private:
+            static constexpr std::size_t maxLookahead = maxSampleRate / 1000 * lookaheadMs;
+            static constexpr std::size_t blockFrames = 1024;
+            static constexpr std::size_t windowSize = 2048; //* Power of two above maxLookahead
+            static_assert(windowSize > maxLookahead);
+
+            //* Set from any thread, picked up on the next period
+            std::atomic<Enums::LimiterMode> mode = Enums::LimiterMode::Lookahead;
+            std::atomic<float> attack = 2.f;    //* In milliseconds, at most the lookahead
+            std::atomic<float> release = 100.f; //* In milliseconds
+            std::atomic<float> ceiling = 1.f;   //* Linear
+
+            //* Only touched by the audio thread
+            std::uint32_t sampleRate = 0;
+            std::size_t lookahead = 0; //* In frames
+            std::uint64_t frame = 0;
+            float gain = 1.f;
+
+            //* The last lookahead frames followed by the block that is being processed
+            std::array<float, (maxLookahead + blockFrames) * 2> line{};
+            std::array<float, blockFrames> peaks{};
+            std::array<float, blockFrames> gains{};
+
+            //* Smallest gain required within the lookahead, kept as a monotonic queue of frame and gain
+            std::array<std::pair<std::uint64_t, float>, windowSize> window{};
+            std::size_t windowHead = 0;
+            std::size_t windowTail = 0;
+
+            void reset(std::uint32_t sampleRate);
+
+          public:
+            void setParameters(Enums::LimiterMode, float attack, float release, float ceiling);
+
+            //* Returns the largest gain reduction in dB. The lookahead delays the signal by lookaheadMs.
+            float process(float *buffer, std::size_t frames, std::uint32_t sampleRate);
+        };
+
+        //* Sidechain envelope follower, yields the gain of a signal that should make room while another one plays
+        class Ducker
+        {
+            //* Set from any thread, picked up on the next block
+            std::atomic<float> depth = 0.25f;  //* Linear gain while ducked
+            std::atomic<float> attack = 10.f;  //* In milliseconds
+            std::atomic<float> release = 300.f; //* In milliseconds
+
+            float gain = 1.f; //* Only touched by the audio thread
+
+          public:
+            void setParameters(float amount, float attack, float release); //* Amount in dB, times in ms
+
+            //* Follows the interleaved stereo sidechain for the given frames and returns the gain at their end
+            float process(const float *sidechain, std::size_t frames, std::uint32_t sampleRate);
+            float getGain() const;
+        };
+    } // namespace Helpers
+} // namespace Soundux
@@ -0,0 +1,45 @@
+#include "dsp.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Soundux::Helpers
+{
+    namespace
+    {
+        //* Anything quieter than -50 dBFS on the sidechain doesn't count as playing
+        constexpr float threshold = 0.00316f;
+    } // namespace
+
+    void Ducker::setParameters(float amount, float newAttack, float newRelease)
+    {
+        depth = std::pow(10.f, -std::max(amount, 0.f) / 20.f);
+        attack = std::max(newAttack, 0.1f);
+        release = std::max(newRelease, 0.1f);
+    }
+    float Ducker::process(const float *sidechain, std::size_t frames, std::uint32_t sampleRate)
+    {
+        if (frames == 0 || sampleRate == 0)
+        {
+            return gain;
+        }
+
+        auto peak = 0.f;
+        for (std::size_t i = 0; frames * 2 > i; i++)
+        {
+            peak = std::max(peak, std::abs(sidechain[i]));
+        }
+
+        const auto target = peak > threshold ? depth.load(std::memory_order_relaxed) : 1.f;
+        const auto time = (target < gain ? attack : release).load(std::memory_order_relaxed);
+
+        //* Settles to 98% within the given time, advanced by the whole block at once
+        const auto settle = time * static_cast<float>(sampleRate) / 1000.f;
+        gain += (target - gain) * (1.f - std::exp(-4.f * static_cast<float>(frames) / settle));
+
+        return gain;
+    }
+    float Ducker::getGain() const
+    {
+        return gain;
+    }
+} // namespace Soundux::Helpers
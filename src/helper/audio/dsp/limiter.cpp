@@ -0,0 +1,108 @@
+#include "dsp.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Soundux::Helpers
+{
+    namespace
+    {
+        //* The limiter holds the signal slightly below the ceiling, the soft clipper only bends the overshoot
+        //* above that. Without the limiter the clipper starts bending earlier, at the cost of some distortion.
+        constexpr float limiterKnee = 0.95f;
+        constexpr float clipperKnee = 0.7f;
+
+        float coefficient(float milliseconds, std::uint32_t sampleRate)
+        {
+            //* Settles to 98% within the given time
+            const auto frames = std::max(1.f, milliseconds * static_cast<float>(sampleRate) / 1000.f);
+            return 1.f - std::exp(-4.f / frames);
+        }
+    } // namespace
+
+    void Limiter::setParameters(Enums::LimiterMode newMode, float newAttack, float newRelease, float newCeiling)
+    {
+        attack = std::clamp(newAttack, 0.1f, static_cast<float>(lookaheadMs));
+        release = std::max(newRelease, 1.f);
+        ceiling = std::pow(10.f, std::min(newCeiling, 0.f) / 20.f);
+        mode = newMode;
+    }
+    void Limiter::reset(std::uint32_t newSampleRate)
+    {
+        sampleRate = std::min(newSampleRate, maxSampleRate);
+        lookahead = static_cast<std::size_t>(sampleRate) * lookaheadMs / 1000;
+
+        frame = 0;
+        gain = 1.f;
+        windowHead = 0;
+        windowTail = 0;
+        std::fill(line.begin(), line.begin() + static_cast<std::ptrdiff_t>(lookahead * 2), 0.f);
+    }
+    float Limiter::process(float *buffer, std::size_t frames, std::uint32_t rate)
+    {
+        const auto currentMode = mode.load(std::memory_order_relaxed);
+        const auto currentCeiling = ceiling.load(std::memory_order_relaxed);
+
+        if (currentMode == Enums::LimiterMode::Off || rate == 0)
+        {
+            return 0.f;
+        }
+        if (currentMode == Enums::LimiterMode::SoftClip)
+        {
+            softClip(buffer, frames * 2, currentCeiling * clipperKnee, currentCeiling);
+            return 0.f;
+        }
+
+        if (rate != sampleRate)
+        {
+            reset(rate);
+        }
+
+        const auto attackCoefficient = coefficient(attack.load(std::memory_order_relaxed), sampleRate);
+        const auto releaseCoefficient = coefficient(release.load(std::memory_order_relaxed), sampleRate);
+        const auto threshold = currentCeiling * limiterKnee;
+
+        auto lowest = 1.f;
+        for (std::size_t offset = 0; frames > offset; offset += blockFrames)
+        {
+            const auto count = std::min(blockFrames, frames - offset);
+            auto *block = buffer + offset * 2;
+
+            std::memcpy(line.data() + lookahead * 2, block, count * 2 * sizeof(float));
+            peakStereo(block, peaks.data(), count);
+
+            for (std::size_t i = 0; count > i; i++)
+            {
+                const auto current = frame + i;
+                const auto required = peaks[i] > threshold ? threshold / peaks[i] : 1.f;
+
+                while (windowTail != windowHead && window[(windowTail - 1) & (windowSize - 1)].second >= required)
+                {
+                    windowTail--;
+                }
+                window[windowTail++ & (windowSize - 1)] = {current, required};
+
+                //* The frame that leaves the delay line now is the oldest one the window has to cover
+                while (window[windowHead & (windowSize - 1)].first + lookahead < current)
+                {
+                    windowHead++;
+                }
+
+                const auto target = window[windowHead & (windowSize - 1)].second;
+                gain += (target - gain) * (target < gain ? attackCoefficient : releaseCoefficient);
+
+                gains[i] = gain;
+                lowest = std::min(lowest, gain);
+            }
+            frame += count;
+
+            applyGain(line.data(), gains.data(), count);
+            std::memcpy(block, line.data(), count * 2 * sizeof(float));
+            std::memmove(line.data(), line.data() + count * 2, lookahead * 2 * sizeof(float));
+        }
+
+        softClip(buffer, frames * 2, threshold, currentCeiling);
+
+        return -20.f * std::log10(lowest);
+    }
+} // namespace Soundux::Helpers
@@ -0,0 +1,175 @@
+#include "dsp.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace Soundux::Helpers
+{
+    namespace
+    {
+        constexpr double pi = 3.14159265358979323846;
+
+        //* Blocks quieter than this are never counted, see ITU-R BS.1770-4
+        constexpr double absoluteGate = -70.0;
+        constexpr double relativeGate = -10.0;
+
+        //* The true peak is measured on a 4x oversampled signal, every phase has its own set of taps
+        constexpr std::size_t oversampling = 4;
+        constexpr std::size_t taps = 12;
+
+        const std::array<float, oversampling * taps> interpolator = [] {
+            std::array<float, oversampling * taps> kernel{};
+            constexpr auto center = static_cast<double>(oversampling * taps - 1) / 2.0;
+
+            for (std::size_t i = 0; kernel.size() > i; i++)
+            {
+                const auto x = (static_cast<double>(i) - center) / oversampling;
+                const auto u = (static_cast<double>(i) + 0.5) / static_cast<double>(kernel.size());
+
+                const auto sinc = x == 0 ? 1.0 : std::sin(pi * x) / (pi * x);
+                const auto window = 0.42 - 0.5 * std::cos(2 * pi * u) + 0.08 * std::cos(4 * pi * u);
+
+                kernel[i] = static_cast<float>(sinc * window);
+            }
+
+            return kernel;
+        }();
+
+        double toLoudness(double energy)
+        {
+            return energy > 0 ? -0.691 + 10.0 * std::log10(energy) : -std::numeric_limits<double>::infinity();
+        }
+        double filter(const std::array<double, 5> &coefficients, double *state, double input)
+        {
+            //* Transposed direct form II
+            const auto output = coefficients[0] * input + state[0];
+            state[0] = coefficients[1] * input - coefficients[3] * output + state[1];
+            state[1] = coefficients[2] * input - coefficients[4] * output;
+
+            return output;
+        }
+    } // namespace
+
+    LoudnessMeter::LoudnessMeter(std::uint32_t channels, std::uint32_t sampleRate)
+        : channels(std::max(1u, channels)), stepFrames(std::max(1u, sampleRate / 10)),
+          filterState(static_cast<std::size_t>(this->channels) * 4), weights(this->channels, 1.0),
+          history(static_cast<std::size_t>(this->channels) * taps)
+    {
+        const auto rate = static_cast<double>(std::max(1u, sampleRate));
+
+        //* Coefficients of BS.1770 derived for any sample rate, they match the published ones at 48 kHz
+        {
+            const auto K = std::tan(pi * 1681.974450955533 / rate);
+            const auto Q = 0.7071752369554196;
+            const auto Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+            const auto Vb = std::pow(Vh, 0.4996667741545416);
+            const auto a0 = 1.0 + K / Q + K * K;
+
+            shelf = {(Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+                     2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0};
+        }
+        {
+            const auto K = std::tan(pi * 38.13547087602444 / rate);
+            const auto Q = 0.5003270373238773;
+            const auto a0 = 1.0 + K / Q + K * K;
+
+            highPass = {1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0};
+        }
+
+        //* 5.1 layouts leave out the lfe channel and weigh the surround channels higher
+        if (this->channels == 6)
+        {
+            weights = {1.0, 1.0, 1.0, 0.0, 1.41, 1.41};
+        }
+    }
+
+    void LoudnessMeter::process(const float *samples, std::size_t frames)
+    {
+        for (std::size_t i = 0; frames > i; i++)
+        {
+            historyPosition = (historyPosition + 1) % taps;
+
+            for (std::uint32_t channel = 0; channels > channel; channel++)
+            {
+                const auto sample = samples[i * channels + channel];
+                auto *state = filterState.data() + static_cast<std::size_t>(channel) * 4;
+
+                const auto weighted = filter(highPass, state + 2, filter(shelf, state, sample));
+                stepEnergy += weights[channel] * weighted * weighted;
+
+                auto *past = history.data() + static_cast<std::size_t>(channel) * taps;
+                past[historyPosition] = sample;
+
+                for (std::size_t phase = 0; oversampling > phase; phase++)
+                {
+                    float interpolated = 0;
+                    for (std::size_t tap = 0; taps > tap; tap++)
+                    {
+                        interpolated += interpolator[tap * oversampling + phase] *
+                                        past[(historyPosition + taps - tap) % taps];
+                    }
+                    peak = std::max(peak, std::abs(interpolated));
+                }
+                peak = std::max(peak, std::abs(sample));
+            }
+
+            if (++stepPosition == stepFrames)
+            {
+                steps.emplace_back(stepEnergy / stepFrames);
+                stepEnergy = 0;
+                stepPosition = 0;
+            }
+        }
+    }
+
+    double LoudnessMeter::getIntegrated() const
+    {
+        //* Gating blocks are 400 ms long and overlap by 75%, sounds shorter than that are measured as a whole
+        std::vector<double> blocks;
+        if (steps.size() < 4)
+        {
+            const auto frames = steps.size() * stepFrames + stepPosition;
+            if (frames == 0)
+            {
+                return -std::numeric_limits<double>::infinity();
+            }
+
+            const auto energy = std::accumulate(steps.begin(), steps.end(), 0.0) * stepFrames + stepEnergy;
+            blocks.emplace_back(energy / static_cast<double>(frames));
+        }
+        else
+        {
+            for (std::size_t i = 3; steps.size() > i; i++)
+            {
+                blocks.emplace_back((steps[i - 3] + steps[i - 2] + steps[i - 1] + steps[i]) / 4.0);
+            }
+        }
+
+        auto gatedMean = [&](double gate) {
+            double sum = 0;
+            std::size_t count = 0;
+            for (const auto &block : blocks)
+            {
+                if (toLoudness(block) > gate)
+                {
+                    sum += block;
+                    count++;
+                }
+            }
+            return count > 0 ? sum / static_cast<double>(count) : 0.0;
+        };
+
+        const auto ungated = gatedMean(absoluteGate);
+        if (ungated <= 0)
+        {
+            return -std::numeric_limits<double>::infinity();
+        }
+
+        return toLoudness(gatedMean(toLoudness(ungated) + relativeGate));
+    }
+    double LoudnessMeter::getTruePeak() const
+    {
+        return peak > 0 ? 20.0 * std::log10(peak) : -std::numeric_limits<double>::infinity();
+    }
+} // namespace Soundux::Helpers
@@ -0,0 +1,115 @@
+#include "dsp.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Soundux::Helpers
+{
+    namespace
+    {
+        constexpr double pi = 3.14159265358979323846;
+
+        //* Width of the sinc kernel on each side, in zero crossings
+        constexpr std::size_t zeroCrossings = 16;
+        //* Resolution of the kernel table, positions in between are interpolated
+        constexpr std::size_t phases = 512;
+        //* Keeps the transition band below the nyquist frequency of the lower rate
+        constexpr double rolloff = 0.95;
+
+        std::vector<float> resampleLinear(const std::vector<float> &input, std::uint32_t channels, double step,
+                                          std::size_t outputFrames)
+        {
+            const auto inputFrames = input.size() / channels;
+            std::vector<float> output(outputFrames * channels);
+
+            for (std::size_t i = 0; outputFrames > i; i++)
+            {
+                const auto position = static_cast<double>(i) * step;
+                const auto index = std::min(static_cast<std::size_t>(position), inputFrames - 1);
+                const auto next = std::min(index + 1, inputFrames - 1);
+                const auto fraction = static_cast<float>(position - static_cast<double>(index));
+
+                for (std::uint32_t channel = 0; channels > channel; channel++)
+                {
+                    const auto a = input[index * channels + channel];
+                    const auto b = input[next * channels + channel];
+                    output[i * channels + channel] = a + (b - a) * fraction;
+                }
+            }
+
+            return output;
+        }
+
+        std::vector<float> resampleSinc(const std::vector<float> &input, std::uint32_t channels, double step,
+                                        std::size_t outputFrames)
+        {
+            //* When downsampling the kernel is stretched so that it also acts as the anti-aliasing filter
+            const auto cutoff = std::min(1.0, 1.0 / step) * rolloff;
+            const auto width = static_cast<std::ptrdiff_t>(std::ceil(static_cast<double>(zeroCrossings) / cutoff));
+
+            //* One half of the blackman windowed sinc, sampled at `phases` points per input frame
+            std::vector<float> kernel(static_cast<std::size_t>(width) * phases + 2);
+            for (std::size_t i = 0; kernel.size() > i; i++)
+            {
+                const auto x = static_cast<double>(i) / phases;
+                const auto u = std::min(1.0, x / static_cast<double>(width));
+
+                const auto sinc = x == 0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+                const auto window = 0.42 + 0.5 * std::cos(pi * u) + 0.08 * std::cos(2 * pi * u);
+
+                kernel[i] = static_cast<float>(cutoff * sinc * window);
+            }
+
+            const auto inputFrames = static_cast<std::ptrdiff_t>(input.size() / channels);
+            std::vector<float> output(outputFrames * channels);
+            std::vector<float> sums(channels);
+
+            for (std::size_t i = 0; outputFrames > i; i++)
+            {
+                const auto position = static_cast<double>(i) * step;
+                const auto center = static_cast<std::ptrdiff_t>(position);
+                const auto fraction = position - static_cast<double>(center);
+
+                std::fill(sums.begin(), sums.end(), 0.f);
+
+                const auto first = std::max<std::ptrdiff_t>(0, center - width + 1);
+                const auto last = std::min(inputFrames - 1, center + width);
+                for (auto frame = first; last >= frame; frame++)
+                {
+                    const auto distance = std::abs(static_cast<double>(frame - center) - fraction) * phases;
+                    const auto index = static_cast<std::size_t>(distance);
+                    const auto weight = kernel[index] + (kernel[index + 1] - kernel[index]) *
+                                                            static_cast<float>(distance - static_cast<double>(index));
+
+                    for (std::uint32_t channel = 0; channels > channel; channel++)
+                    {
+                        sums[channel] += input[static_cast<std::size_t>(frame) * channels + channel] * weight;
+                    }
+                }
+
+                std::copy(sums.begin(), sums.end(), output.begin() + static_cast<std::ptrdiff_t>(i * channels));
+            }
+
+            return output;
+        }
+    } // namespace
+
+    std::vector<float> resample(const std::vector<float> &input, std::uint32_t channels, std::uint32_t from,
+                                std::uint32_t to, Enums::ResampleQuality quality)
+    {
+        if (from == to || input.empty() || channels == 0 || from == 0 || to == 0)
+        {
+            return input;
+        }
+
+        const auto inputFrames = input.size() / channels;
+        const auto outputFrames = static_cast<std::size_t>(static_cast<std::uint64_t>(inputFrames) * to / from);
+        const auto step = static_cast<double>(from) / static_cast<double>(to);
+
+        if (quality == Enums::ResampleQuality::Linear)
+        {
+            return resampleLinear(input, channels, step, outputFrames);
+        }
+
+        return resampleSinc(input, channels, step, outputFrames);
+    }
+} // namespace Soundux::Helpers
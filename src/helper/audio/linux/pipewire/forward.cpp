@@ -47,6 +47,21 @@ bool Soundux::PipeWireApi::setup()
             load(main_loop_destroy);
             load(main_loop_get_loop);
             load(proxy_add_listener);
+
+            load(stream_connect);
+            load(stream_destroy);
+            load(thread_loop_new);
+            load(thread_loop_lock);
+            load(thread_loop_stop);
+            load(stream_new_simple);
+            load(thread_loop_start);
+            load(thread_loop_unlock);
+            load(stream_get_node_id);
+            load(thread_loop_destroy);
+            load(stream_queue_buffer);
+            load(thread_loop_get_loop);
+            load(stream_dequeue_buffer);
+            load(stream_update_properties);
             return true;
         }
         catch (std::exception &e)
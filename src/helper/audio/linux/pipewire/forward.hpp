@@ -27,6 +27,24 @@ namespace Soundux
         inline int (*core_disconnect)(pw_core *);
         inline void (*proxy_destroy)(pw_proxy *);
         inline void (*init)(int *, char **);
+
+        inline pw_stream *(*stream_new_simple)(pw_loop *, const char *, pw_properties *, const pw_stream_events *,
+                                               void *);
+        inline int (*stream_connect)(pw_stream *, spa_direction, std::uint32_t, pw_stream_flags, const spa_pod **,
+                                     std::uint32_t);
+        inline int (*stream_update_properties)(pw_stream *, const spa_dict *);
+        inline pw_buffer *(*stream_dequeue_buffer)(pw_stream *);
+        inline int (*stream_queue_buffer)(pw_stream *, pw_buffer *);
+        inline std::uint32_t (*stream_get_node_id)(pw_stream *);
+        inline void (*stream_destroy)(pw_stream *);
+
+        inline pw_thread_loop *(*thread_loop_new)(const char *, const spa_dict *);
+        inline pw_loop *(*thread_loop_get_loop)(pw_thread_loop *);
+        inline void (*thread_loop_destroy)(pw_thread_loop *);
+        inline void (*thread_loop_unlock)(pw_thread_loop *);
+        inline int (*thread_loop_start)(pw_thread_loop *);
+        inline void (*thread_loop_stop)(pw_thread_loop *);
+        inline void (*thread_loop_lock)(pw_thread_loop *);
     } // namespace PipeWireApi
 } // namespace Soundux
 #endif
\ No newline at end of file
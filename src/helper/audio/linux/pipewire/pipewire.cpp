@@ -1,9 +1,13 @@
 #if defined(__linux__)
 #include "pipewire.hpp"
 #include "forward.hpp"
+#include <algorithm>
+#include <array>
+#include <core/global/globals.hpp>
 #include <fancy.hpp>
 #include <memory>
 #include <optional>
+#include <spa/param/audio/format-utils.h>
 #include <stdexcept>
 
 namespace Soundux::Objects
@@ -168,6 +172,13 @@ namespace Soundux::Objects
             }
             if (strcmp(type, PW_TYPE_INTERFACE_Node) == 0)
             {
+                if (const auto *mediaClass = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+                    mediaClass && (strcmp(mediaClass, "Audio/Sink") == 0 || strcmp(mediaClass, "Audio/Source") == 0))
+                {
+                    thiz->devices->emplace(id);
+                    Globals::gAudio.onDevicesChanged();
+                }
+
                 const auto *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
                 if (name && strstr(name, "soundux"))
                 {
@@ -261,6 +272,11 @@ namespace Soundux::Objects
             {
                 scopedPorts->erase(id);
             }
+
+            if (thiz->devices->erase(id))
+            {
+                Globals::gAudio.onDevicesChanged();
+            }
         }
     }
 
@@ -305,11 +321,20 @@ namespace Soundux::Objects
 
         sync();
 
+        //* The null sink is still needed for passthrough
+        if (!createStream())
+        {
+            Fancy::fancy.logTime().warning() << "Failed to create playback stream, sounds will be played through "
+                                                "the null sink instead"
+                                             << std::endl;
+        }
+
         return createNullSink();
     }
 
     void PipeWire::destroy()
     {
+        destroyStream();
         PipeWireApi::proxy_destroy(reinterpret_cast<pw_proxy *>(registry));
         PipeWireApi::core_disconnect(core);
         PipeWireApi::context_destroy(context);
@@ -353,6 +378,205 @@ namespace Soundux::Objects
         return success;
     }
 
+    bool PipeWire::createStream()
+    {
+        streamLoop = PipeWireApi::thread_loop_new("soundux-stream", nullptr);
+        if (!streamLoop)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to create stream loop" << std::endl;
+            return false;
+        }
+
+        quantum = Globals::gSettings.pipeWireQuantum;
+
+        //* The stream is never connected to a device by the session manager, it only feeds the apps we link it to
+        //* and is scheduled by the graph driver even while nothing is linked.
+        pw_properties *props = PipeWireApi::properties_new(nullptr, nullptr);
+        PipeWireApi::properties_set(props, PW_KEY_MEDIA_TYPE, "Audio");
+        PipeWireApi::properties_set(props, PW_KEY_MEDIA_CATEGORY, "Playback");
+        PipeWireApi::properties_set(props, PW_KEY_NODE_NAME, "soundux_playback");
+        PipeWireApi::properties_set(props, PW_KEY_NODE_DESCRIPTION, "Soundux");
+        PipeWireApi::properties_set(props, PW_KEY_NODE_AUTOCONNECT, "false");
+        PipeWireApi::properties_set(props, PW_KEY_NODE_WANT_DRIVER, "true");
+        PipeWireApi::properties_set(props, "node.always-process", "true");
+        PipeWireApi::properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", quantum.load(), streamRate);
+
+        streamEvents = {};
+        streamEvents.version = PW_VERSION_STREAM_EVENTS;
+        streamEvents.process = onProcess;
+        streamEvents.state_changed = [](void *data, [[maybe_unused]] pw_stream_state old, pw_stream_state state,
+                                        const char *error) {
+            auto *thiz = reinterpret_cast<PipeWire *>(data);
+            if (thiz)
+            {
+                if (state == PW_STREAM_STATE_ERROR)
+                {
+                    Fancy::fancy.logTime().failure() << "Playback stream failed: " << (error ? error : "unknown")
+                                                     << std::endl;
+                }
+                else if (state == PW_STREAM_STATE_PAUSED || state == PW_STREAM_STATE_STREAMING)
+                {
+                    thiz->streamNode = PipeWireApi::stream_get_node_id(thiz->stream);
+                }
+            }
+        };
+
+        //* Takes ownership of the properties
+        stream = PipeWireApi::stream_new_simple(PipeWireApi::thread_loop_get_loop(streamLoop), "soundux_playback",
+                                                props, &streamEvents, this);
+        if (!stream)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to create playback stream" << std::endl;
+            destroyStream();
+            return false;
+        }
+
+        std::array<std::uint8_t, 1024> buffer;
+        spa_pod_builder builder{};
+        spa_pod_builder_init(&builder, buffer.data(), buffer.size());
+
+        spa_audio_info_raw info{};
+        info.format = SPA_AUDIO_FORMAT_F32;
+        info.rate = streamRate;
+        info.channels = 2;
+        info.position[0] = SPA_AUDIO_CHANNEL_FL;
+        info.position[1] = SPA_AUDIO_CHANNEL_FR;
+
+        const spa_pod *params[] = {spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info)};
+
+        if (PipeWireApi::stream_connect(stream, SPA_DIRECTION_OUTPUT, PW_ID_ANY, PW_STREAM_FLAG_MAP_BUFFERS, params,
+                                        1) < 0)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to connect playback stream" << std::endl;
+            destroyStream();
+            return false;
+        }
+        if (PipeWireApi::thread_loop_start(streamLoop) < 0)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to start stream loop" << std::endl;
+            destroyStream();
+            return false;
+        }
+
+        return true;
+    }
+
+    void PipeWire::destroyStream()
+    {
+        if (streamLoop)
+        {
+            PipeWireApi::thread_loop_stop(streamLoop);
+        }
+        if (stream)
+        {
+            PipeWireApi::stream_destroy(stream);
+            stream = nullptr;
+        }
+        if (streamLoop)
+        {
+            PipeWireApi::thread_loop_destroy(streamLoop);
+            streamLoop = nullptr;
+        }
+
+        streamNode = 0;
+    }
+
+    void PipeWire::onProcess(void *data)
+    {
+        auto *thiz = reinterpret_cast<PipeWire *>(data);
+        auto *buffer = PipeWireApi::stream_dequeue_buffer(thiz->stream);
+
+        if (!buffer)
+        {
+            return;
+        }
+
+        auto &target = buffer->buffer->datas[0];
+        if (target.data)
+        {
+            constexpr std::uint32_t stride = sizeof(float) * 2;
+            auto frames = std::min(target.maxsize / stride, thiz->quantum.load(std::memory_order_relaxed));
+#if PW_CHECK_VERSION(0, 3, 49)
+            //* Newer versions tell us exactly how much the graph wants
+            if (buffer->requested > 0)
+            {
+                frames = std::min(target.maxsize / stride, static_cast<std::uint32_t>(buffer->requested));
+            }
+#endif
+
+            auto *samples = reinterpret_cast<float *>(target.data);
+            std::fill(samples, samples + static_cast<std::size_t>(frames) * 2, 0.f);
+
+            if (thiz->renderCallback)
+            {
+                thiz->renderCallback(thiz->renderData, samples, frames);
+            }
+
+            target.chunk->offset = 0;
+            target.chunk->stride = stride;
+            target.chunk->size = frames * stride;
+        }
+
+        PipeWireApi::stream_queue_buffer(thiz->stream, buffer);
+    }
+
+    std::uint32_t PipeWire::getStreamRate() const
+    {
+        return streamRate;
+    }
+
+    bool PipeWire::setStreamRate(std::uint32_t rate)
+    {
+        if (!stream)
+        {
+            return false;
+        }
+        if (rate == streamRate)
+        {
+            return true;
+        }
+
+        stopSoundInput();
+        destroyStream();
+        streamRate = rate;
+
+        return createStream();
+    }
+
+    void PipeWire::setQuantum(std::uint32_t newQuantum)
+    {
+        quantum = newQuantum;
+        if (!stream)
+        {
+            return;
+        }
+
+        pw_properties *props = PipeWireApi::properties_new(nullptr, nullptr);
+        PipeWireApi::properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", newQuantum, streamRate);
+
+        PipeWireApi::thread_loop_lock(streamLoop);
+        PipeWireApi::stream_update_properties(stream, &props->dict);
+        PipeWireApi::thread_loop_unlock(streamLoop);
+
+        PipeWireApi::properties_free(props);
+    }
+
+    void PipeWire::setRenderer(RenderCallback callback, void *data)
+    {
+        if (streamLoop)
+        {
+            PipeWireApi::thread_loop_lock(streamLoop);
+        }
+
+        renderCallback = callback;
+        renderData = data;
+
+        if (streamLoop)
+        {
+            PipeWireApi::thread_loop_unlock(streamLoop);
+        }
+    }
+
     bool PipeWire::deleteLink(std::uint32_t id)
     {
         pw_registry_destroy(registry, id); // NOLINT
@@ -567,7 +791,9 @@ namespace Soundux::Objects
 
             for (const auto &[portId, port] : ports)
             {
-                if (port.direction == SPA_DIRECTION_OUTPUT && port.portAlias.find("soundux") != std::string::npos)
+                const bool isStream = streamNode != 0 && port.parentNode == streamNode;
+                if (port.direction == SPA_DIRECTION_OUTPUT &&
+                    (isStream || port.portAlias.find("soundux") != std::string::npos))
                 {
                     for (const auto &[nodePortId, nodePort] : node.ports)
                     {
@@ -1,5 +1,6 @@
 #if defined(__linux__)
 #include "../backend.hpp"
+#include <atomic>
 #include <map>
 #include <optional>
 #include <pipewire/pipewire.h>
@@ -73,11 +74,36 @@ namespace Soundux
           private:
             sxl::var_guard<std::map<std::uint32_t, Node>> nodes;
             sxl::var_guard<std::map<std::uint32_t, Port>> ports;
+            //* Sinks and sources, the audio engine refreshes its device list when they come or go
+            sxl::var_guard<std::set<std::uint32_t>> devices;
 
             void onNodeInfo(const pw_node_info *);
             void onPortInfo(const pw_port_info *);
             void onCoreInfo(const pw_core_info *);
 
+          public:
+            //* Fills the given amount of interleaved stereo frames, called from the stream thread
+            using RenderCallback = void (*)(void *, float *, std::uint32_t);
+
+          private:
+            //* The remote output is a native stream node which the mixer renders into,
+            //* its ports are linked straight to the recording apps.
+            pw_thread_loop *streamLoop = nullptr;
+            pw_stream *stream = nullptr;
+            pw_stream_events streamEvents;
+
+            std::uint32_t streamRate = 48000;
+            std::atomic<std::uint32_t> quantum = 0;
+            std::atomic<std::uint32_t> streamNode = 0;
+
+            //* Only changed while holding the stream loop lock, the process callback runs on that loop
+            RenderCallback renderCallback = nullptr;
+            void *renderData = nullptr;
+
+            bool createStream();
+            void destroyStream();
+            static void onProcess(void *);
+
           private:
             std::map<std::string, std::vector<std::uint32_t>> soundInputLinks;
             std::map<std::string, std::vector<std::uint32_t>> passthroughLinks;
@@ -103,6 +129,13 @@ namespace Soundux
             bool revertDefault() override;
             bool muteInput(bool state) override;
 
+            std::uint32_t getStreamRate() const;
+            //* Recreates the stream if it runs at a different rate, which drops its links
+            bool setStreamRate(std::uint32_t);
+            void setQuantum(std::uint32_t);
+            //* Pass nullptr to detach, the stream plays silence until a renderer is set
+            void setRenderer(RenderCallback, void *);
+
             std::set<std::string> currentlyInputApps() override;
             std::set<std::string> currentlyPassedThrough() override;
 
@@ -306,6 +306,12 @@ namespace Soundux::Objects
                 return false;
             }
 
+            fetchLoopBackSinkId();
+            if (inputMuted)
+            {
+                muteInput(true);
+            }
+
             bool success = false;
             await(PulseApi::context_set_default_source(
                 context, "soundux_sink.monitor",
@@ -351,6 +357,12 @@ namespace Soundux::Objects
                 return false;
             }
 
+            fetchLoopBackSinkId();
+            if (inputMuted)
+            {
+                muteInput(true);
+            }
+
             bool success = false;
             await(PulseApi::context_set_default_source(
                 context, defaultSource.c_str(),
@@ -640,10 +652,19 @@ namespace Soundux::Objects
         {
             Fancy::fancy.logTime().failure() << "Failed to mute loopback sink" << std::endl;
         }
+        else
+        {
+            inputMuted = state;
+        }
 
         return success;
     }
 
+    const std::string &PulseAudio::getDefaultSource() const
+    {
+        return defaultSource;
+    }
+
     bool PulseAudio::switchOnConnectPresent()
     {
         bool isPresent = false;
@@ -48,6 +48,7 @@ namespace Soundux
 
             std::string serverName;
             std::string defaultSource;
+            bool inputMuted = false; //* Reapplied whenever the loopback is reloaded
 
             std::map<std::string, std::uint32_t> movedApplications;
             std::map<std::string, std::uint32_t> movedPassthroughApplications;
@@ -76,6 +77,9 @@ namespace Soundux
             bool revertDefault() override;
             bool muteInput(bool state) override;
 
+            //* The source that was the default when we started, before useAsDefault() replaced it
+            const std::string &getDefaultSource() const;
+
             std::set<std::string> currentlyInputApps() override;
             std::set<std::string> currentlyPassedThrough() override;
 
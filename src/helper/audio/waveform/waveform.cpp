@@ -0,0 +1,406 @@
+#include "waveform.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <core/config/config.hpp>
+#include <core/global/globals.hpp>
+#include <fancy.hpp>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <miniaudio.h>
+#include <sstream>
+#include <thread>
+#if defined(_WIN32)
+#include <helper/misc/misc.hpp>
+#endif
+
+namespace Soundux::Objects
+{
+    namespace
+    {
+        constexpr char magic[4] = {'S', 'X', 'W', 'F'};
+        constexpr std::uint32_t version = 1;
+
+        std::int8_t quantize(float sample)
+        {
+            return static_cast<std::int8_t>(std::lround(std::clamp(sample, -1.f, 1.f) * 127.f));
+        }
+
+        template <typename T> void put(std::ofstream &stream, const T &value)
+        {
+            stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+        template <typename T> bool take(std::ifstream &stream, T &value)
+        {
+            return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+        }
+    } // namespace
+
+    void Waveforms::work(const Sound &queued, const std::string &tab)
+    {
+        std::unique_lock lock(waveformMutex);
+
+        //* A cancelled run looks again once it stopped, its tab may have been opened again in the meantime
+        while (true)
+        {
+            auto sound = queued;
+            auto batch = requests;
+            if (!tab.empty())
+            {
+                //* Sounds that a refresh removed or changed since they were queued are skipped or taken as they are now
+                auto it = batches.find(tab);
+                if (it == batches.end())
+                {
+                    return;
+                }
+                auto current = it->second.sounds.find(queued.id);
+                if (current == it->second.sounds.end())
+                {
+                    return;
+                }
+
+                sound = current->second;
+                batch = it->second.cancelled;
+            }
+
+            //* Someone else is already on it, the result ends up in the same sidecar
+            if (*batch || hasFailed(sound) || isRunning(sound))
+            {
+                return;
+            }
+            running.insert_or_assign(sound.path, batch);
+            lock.unlock();
+
+            bool success = true;
+            if (!read(sound, true))
+            {
+                auto waveform = compute(sound, *batch);
+                success = (waveform && write(*waveform)) || *batch;
+            }
+
+            lock.lock();
+            //* A cancelled run may have been overtaken by a new one in the meantime
+            if (auto it = running.find(sound.path); it != running.end() && it->second == batch)
+            {
+                running.erase(it);
+            }
+            if (!success)
+            {
+                failed.insert_or_assign(sound.path, sound.modifiedDate);
+            }
+            if (!*batch)
+            {
+                return;
+            }
+        }
+    }
+    void Waveforms::generate(const Tab &tab)
+    {
+        {
+            std::lock_guard lock(waveformMutex);
+            auto &batch = batches[tab.path];
+            if (!batch.cancelled || *batch.cancelled)
+            {
+                batch.cancelled = std::make_shared<std::atomic<bool>>(false);
+            }
+
+            batch.sounds.clear();
+            for (const auto &sound : tab.sounds)
+            {
+                batch.sounds.emplace(sound.id, sound);
+            }
+        }
+
+        //* Queued behind everything else on the lane, the frontend only needs them once a sound is shown
+        std::size_t rejected = 0;
+        for (const auto &sound : tab.sounds)
+        {
+            auto result = Globals::gQueue.push_unique(Queue::taskId(Queue::TaskType::GenerateWaveform, sound.id),
+                                                      [this, sound, tab = tab.path] { work(sound, tab); });
+
+            if (result == Queue::Result::Full)
+            {
+                rejected++;
+            }
+        }
+
+        if (rejected > 0)
+        {
+            Fancy::fancy.logTime().warning()
+                << "Background queue is full, " << rejected << " waveform(s) will not be generated" << std::endl;
+        }
+    }
+    void Waveforms::cancel(const Tab &tab)
+    {
+        std::lock_guard lock(waveformMutex);
+        if (auto it = batches.find(tab.path); it != batches.end())
+        {
+            *it->second.cancelled = true;
+            batches.erase(it);
+        }
+    }
+    void Waveforms::destroy()
+    {
+        //* Lets the queue shut down without waiting for a whole file to be decoded
+        std::lock_guard lock(waveformMutex);
+        *requests = true;
+        for (auto &[tab, batch] : batches)
+        {
+            *batch.cancelled = true;
+        }
+    }
+    std::optional<WaveformLevel> Waveforms::get(const Sound &sound, std::uint32_t width)
+    {
+        auto waveform = read(sound);
+        if (!waveform)
+        {
+            {
+                std::lock_guard lock(waveformMutex);
+                if (hasFailed(sound) || isRunning(sound))
+                {
+                    return std::nullopt;
+                }
+            }
+
+            //* Asked for before its batch got to it, so it skips ahead of the other background work
+            Globals::gQueue.push_unique(Queue::taskId(Queue::TaskType::RequestWaveform, sound.id),
+                                        [this, sound] { work(sound, {}); });
+
+            return std::nullopt;
+        }
+        if (waveform->levels.empty())
+        {
+            return std::nullopt;
+        }
+
+        //* Levels get coarser towards the end, pick the last one that is still wide enough
+        std::size_t level = 0;
+        while (level + 1 < waveform->levels.size() && waveform->levels[level + 1].size() / 2 >= width)
+        {
+            level++;
+        }
+
+        WaveformLevel rtn;
+        rtn.frames = waveform->frames;
+        rtn.sampleRate = waveform->sampleRate;
+        rtn.bucketFrames = static_cast<std::uint64_t>(Waveform::bucketFrames) << level;
+        rtn.peaks = std::move(waveform->levels[level]);
+
+        return rtn;
+    }
+    bool Waveforms::hasFailed(const Sound &sound) const
+    {
+        //* A file that changed is worth another try
+        auto it = failed.find(sound.path);
+        return it != failed.end() && it->second == sound.modifiedDate;
+    }
+    bool Waveforms::isRunning(const Sound &sound) const
+    {
+        //* A run whose batch was cancelled throws its result away, so it does not count
+        auto it = running.find(sound.path);
+        return it != running.end() && !*it->second;
+    }
+    std::string Waveforms::getSidecar(const std::string &path)
+    {
+        std::stringstream name;
+        name << std::hex << std::hash<std::string>{}(path) << ".peaks";
+
+        return (std::filesystem::path(Config::path).parent_path() / "waveforms" / name.str()).string();
+    }
+    std::optional<Waveform> Waveforms::read(const Sound &sound, bool headerOnly)
+    {
+        std::ifstream stream(getSidecar(sound.path), std::ios::binary);
+        if (!stream)
+        {
+            return std::nullopt;
+        }
+
+        std::array<char, sizeof(magic)> fileMagic{};
+        std::uint32_t fileVersion = 0;
+        if (!stream.read(fileMagic.data(), fileMagic.size()) ||
+            !std::equal(fileMagic.begin(), fileMagic.end(), magic) || !take(stream, fileVersion) ||
+            fileVersion != version)
+        {
+            return std::nullopt;
+        }
+
+        //* The path is stored as well, two files could end up with the same hash
+        std::uint32_t pathLength = 0;
+        if (!take(stream, pathLength) || pathLength != sound.path.size())
+        {
+            return std::nullopt;
+        }
+
+        Waveform waveform;
+        waveform.path.resize(pathLength);
+        std::uint32_t levelCount = 0;
+
+        if (!stream.read(waveform.path.data(), pathLength) || waveform.path != sound.path ||
+            !take(stream, waveform.modifiedDate) || waveform.modifiedDate != sound.modifiedDate ||
+            !take(stream, waveform.frames) || !take(stream, waveform.sampleRate) || !take(stream, levelCount))
+        {
+            return std::nullopt;
+        }
+        if (headerOnly)
+        {
+            return waveform;
+        }
+
+        for (std::uint32_t i = 0; levelCount > i; i++)
+        {
+            std::uint32_t peaks = 0;
+            if (!take(stream, peaks))
+            {
+                return std::nullopt;
+            }
+
+            auto &level = waveform.levels.emplace_back(static_cast<std::size_t>(peaks) * 2);
+            if (!stream.read(reinterpret_cast<char *>(level.data()), static_cast<std::streamsize>(level.size())))
+            {
+                return std::nullopt;
+            }
+        }
+
+        return waveform;
+    }
+    bool Waveforms::write(const Waveform &waveform)
+    {
+        const auto sidecar = getSidecar(waveform.path);
+
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(sidecar).parent_path(), ec);
+
+        //* Written to a temporary file first so readers never see a half written sidecar
+        std::stringstream temporaryName;
+        temporaryName << sidecar << "." << std::this_thread::get_id() << ".tmp";
+        const auto temporary = temporaryName.str();
+        {
+            std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+            if (!stream)
+            {
+                Fancy::fancy.logTime().warning() << "Failed to write waveform of " << waveform.path << std::endl;
+                return false;
+            }
+
+            //* Everything is stored in the byte order of the machine, the sidecar is never shared
+            stream.write(magic, sizeof(magic));
+            put(stream, version);
+            put(stream, static_cast<std::uint32_t>(waveform.path.size()));
+            stream.write(waveform.path.data(), static_cast<std::streamsize>(waveform.path.size()));
+            put(stream, waveform.modifiedDate);
+            put(stream, waveform.frames);
+            put(stream, waveform.sampleRate);
+            put(stream, static_cast<std::uint32_t>(waveform.levels.size()));
+
+            for (const auto &level : waveform.levels)
+            {
+                put(stream, static_cast<std::uint32_t>(level.size() / 2));
+                stream.write(reinterpret_cast<const char *>(level.data()), static_cast<std::streamsize>(level.size()));
+            }
+
+            if (!stream)
+            {
+                Fancy::fancy.logTime().warning() << "Failed to write waveform of " << waveform.path << std::endl;
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporary, sidecar, ec);
+        if (ec)
+        {
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+
+        return true;
+    }
+    std::optional<Waveform> Waveforms::compute(const Sound &sound, const std::atomic<bool> &cancelled)
+    {
+        ma_decoder decoder;
+        auto config = ma_decoder_config_init(ma_format_f32, 0, 0);
+#if defined(_WIN32)
+        auto res = ma_decoder_init_file_w(Helpers::widen(sound.path).c_str(), &config, &decoder);
+#else
+        auto res = ma_decoder_init_file(sound.path.c_str(), &config, &decoder);
+#endif
+        if (res != MA_SUCCESS)
+        {
+            Fancy::fancy.logTime().warning() << "Failed to create decoder for waveform of " << sound.path
+                                             << ", error: " >> res << std::endl;
+            return std::nullopt;
+        }
+
+        Waveform waveform;
+        waveform.path = sound.path;
+        waveform.modifiedDate = sound.modifiedDate;
+        waveform.sampleRate = decoder.outputSampleRate;
+
+        const auto channels = decoder.outputChannels;
+        constexpr std::uint64_t chunkFrames = Waveform::bucketFrames * 16;
+        std::vector<float> buffer(chunkFrames * channels);
+
+        auto &finest = waveform.levels.emplace_back();
+        float low = 0.f;
+        float high = 0.f;
+        std::uint32_t filled = 0;
+
+        while (!cancelled)
+        {
+            const auto read = ma_decoder_read_pcm_frames(&decoder, buffer.data(), chunkFrames);
+            for (std::uint64_t frame = 0; read > frame; frame++)
+            {
+                for (std::uint32_t channel = 0; channels > channel; channel++)
+                {
+                    const auto sample = buffer[frame * channels + channel];
+                    low = std::min(low, sample);
+                    high = std::max(high, sample);
+                }
+
+                if (++filled == Waveform::bucketFrames)
+                {
+                    finest.push_back(quantize(low));
+                    finest.push_back(quantize(high));
+                    low = high = 0.f;
+                    filled = 0;
+                }
+            }
+            waveform.frames += read;
+
+            if (read < chunkFrames)
+            {
+                break;
+            }
+        }
+        ma_decoder_uninit(&decoder);
+
+        if (cancelled)
+        {
+            return std::nullopt;
+        }
+        if (filled)
+        {
+            finest.push_back(quantize(low));
+            finest.push_back(quantize(high));
+        }
+
+        //* Every further level merges two neighbouring peaks until only one is left
+        while (waveform.levels.back().size() > 2)
+        {
+            const auto &previous = waveform.levels.back();
+
+            std::vector<std::int8_t> level;
+            level.reserve(previous.size() / 2 + 2);
+            for (std::size_t i = 0; previous.size() > i; i += 4)
+            {
+                const auto hasNext = i + 2 < previous.size();
+                level.push_back(hasNext ? std::min(previous[i], previous[i + 2]) : previous[i]);
+                level.push_back(hasNext ? std::max(previous[i + 1], previous[i + 3]) : previous[i + 1]);
+            }
+
+            waveform.levels.emplace_back(std::move(level));
+        }
+
+        return waveform;
+    }
+} // namespace Soundux::Objects
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <core/objects/objects.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Soundux
+{
+    namespace Objects
+    {
+        //* Min/max peaks of a sound at several resolutions, every level merges two peaks of the one before
+        struct Waveform
+        {
+            static constexpr std::uint32_t bucketFrames = 256; //* Frames of the file covered by a peak of level 0
+
+            std::string path;
+            std::uint64_t modifiedDate = 0;
+            std::uint64_t frames = 0;
+            std::uint32_t sampleRate = 0;
+
+            //* One min/max pair per bucket taken across all channels, quantized to 8 bit
+            std::vector<std::vector<std::int8_t>> levels;
+        };
+        //* A single level of a waveform, as it is handed to the frontend
+        struct WaveformLevel
+        {
+            std::uint64_t frames;
+            std::uint32_t sampleRate;
+            std::uint64_t bucketFrames; //* Frames of the file covered by one min/max pair
+            std::vector<std::int8_t> peaks;
+        };
+
+        //* Computes waveforms on the background lane of the queue and keeps them in a binary sidecar file per sound,
+        //* files whose sidecar matches their modifiedDate are never decoded again
+        class Waveforms
+        {
+            struct Batch
+            {
+                std::shared_ptr<std::atomic<bool>> cancelled;
+                std::map<std::uint32_t, Sound> sounds; //* By id, queued tasks only carry the sound they were queued for
+            };
+
+            //* The batch of every tab whose waveforms are wanted, by path since tab ids change when a tab is removed
+            std::map<std::string, Batch> batches;
+            //* Sounds the frontend asked for directly, only cancelled on shutdown
+            std::shared_ptr<std::atomic<bool>> requests = std::make_shared<std::atomic<bool>>(false);
+
+            //* Paths that are being decoded right now with the batch of the run, and the modifiedDate of files that
+            //* could not be decoded
+            std::map<std::string, std::shared_ptr<std::atomic<bool>>> running;
+            std::map<std::string, std::uint64_t> failed;
+            std::mutex waveformMutex;
+
+          private:
+            void work(const Sound &, const std::string &);
+            bool hasFailed(const Sound &) const; //* Expects waveformMutex to be locked
+            bool isRunning(const Sound &) const; //* Expects waveformMutex to be locked
+
+            static std::string getSidecar(const std::string &);
+            static std::optional<Waveform> read(const Sound &, bool headerOnly = false);
+            static bool write(const Waveform &);
+            static std::optional<Waveform> compute(const Sound &, const std::atomic<bool> &);
+
+          public:
+            //* Queues every sound of the tab, sounds that are still queued from an earlier call are not queued twice
+            //* but decode the sound as it is now. Refreshed tabs should be cancelled first.
+            void generate(const Tab &);
+            //* Sounds of the tab that are still queued are skipped and the ones being decoded are abandoned
+            void cancel(const Tab &);
+            void destroy();
+
+            //* The coarsest level that still has a peak for every pixel of the given width
+            std::optional<WaveformLevel> get(const Sound &, std::uint32_t);
+        };
+    } // namespace Objects
+} // namespace Soundux
@@ -40,6 +40,61 @@ namespace Soundux
             }
             std::transform(guid.begin(), guid.end(), guid.begin(), [](char c) { return tolower(c); });
         }
+        ULONG DeviceNotifier::AddRef()
+        {
+            return ++references;
+        }
+        ULONG DeviceNotifier::Release()
+        {
+            auto remaining = --references;
+            if (remaining == 0)
+            {
+                delete this; // NOLINT
+            }
+
+            return remaining;
+        }
+        HRESULT DeviceNotifier::QueryInterface(REFIID riid, void **object)
+        {
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient))
+            {
+                AddRef();
+                *object = static_cast<IMMNotificationClient *>(this);
+                return S_OK;
+            }
+
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        HRESULT DeviceNotifier::OnDeviceAdded([[maybe_unused]] LPCWSTR id)
+        {
+            Globals::gAudio.onDevicesChanged();
+            return S_OK;
+        }
+        HRESULT DeviceNotifier::OnDeviceRemoved([[maybe_unused]] LPCWSTR id)
+        {
+            Globals::gAudio.onDevicesChanged();
+            return S_OK;
+        }
+        HRESULT DeviceNotifier::OnDeviceStateChanged([[maybe_unused]] LPCWSTR id, [[maybe_unused]] DWORD state)
+        {
+            Globals::gAudio.onDevicesChanged();
+            return S_OK;
+        }
+        HRESULT DeviceNotifier::OnDefaultDeviceChanged(EDataFlow flow, ERole role, [[maybe_unused]] LPCWSTR id)
+        {
+            //* This is reported once for every role
+            if (flow == eRender && role == eConsole)
+            {
+                Globals::gAudio.onDevicesChanged();
+            }
+            return S_OK;
+        }
+        HRESULT DeviceNotifier::OnPropertyValueChanged([[maybe_unused]] LPCWSTR id,
+                                                       [[maybe_unused]] const PROPERTYKEY key)
+        {
+            return S_OK;
+        }
         bool WinSound::setup()
         {
             CoInitialize(nullptr);
@@ -50,6 +105,17 @@ namespace Soundux
                 enumerator = std::shared_ptr<IMMDeviceEnumerator>(
                     rawEnumerator, [](IMMDeviceEnumerator *enumPtr) { enumPtr->Release(); });
 
+                notifier = new DeviceNotifier(); // NOLINT
+                if (FAILED(enumerator->RegisterEndpointNotificationCallback(notifier)))
+                {
+                    Fancy::fancy.logTime().warning()
+                        << "Failed to register device notifications, devices have to be refreshed manually"
+                        << std::endl;
+
+                    notifier->Release();
+                    notifier = nullptr;
+                }
+
                 IMMDevice *defaultDevice = nullptr;
                 enumerator->GetDefaultAudioEndpoint(eCapture, eMultimedia, &defaultDevice);
                 defaultRecordingDevice = RecordingDevice(defaultDevice);
@@ -266,6 +332,14 @@ namespace Soundux
             Fancy::fancy.logTime().warning() << "Failed to get destination for " << name << std::endl;
             return "";
         }
+        WinSound::~WinSound()
+        {
+            if (notifier)
+            {
+                enumerator->UnregisterEndpointNotificationCallback(notifier);
+                notifier->Release();
+            }
+        }
         std::shared_ptr<WinSound> WinSound::createInstance()
         {
             auto instance = std::shared_ptr<WinSound>(new WinSound()); // NOLINT
@@ -1,5 +1,6 @@
 #pragma once
 #if defined(_WIN32)
+#include <atomic>
 #include <fancy.hpp>
 #include <mmdeviceapi.h>
 #include <optional>
@@ -59,13 +60,32 @@ namespace Soundux
             bool playbackThrough(const PlaybackDevice &) const;
         };
 
+        //* Lets the audio engine know when its cached device list is outdated
+        class DeviceNotifier : public IMMNotificationClient
+        {
+            std::atomic<ULONG> references = 1;
+
+          public:
+            ULONG STDMETHODCALLTYPE AddRef() override;
+            ULONG STDMETHODCALLTYPE Release() override;
+            HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void **) override;
+
+            HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR) override;
+            HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR) override;
+            HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR, DWORD) override;
+            HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow, ERole, LPCWSTR) override;
+            HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY) override;
+        };
+
         class WinSound
         {
             bool setup();
             std::shared_ptr<IMMDeviceEnumerator> enumerator;
             std::optional<RecordingDevice> defaultRecordingDevice;
+            DeviceNotifier *notifier = nullptr;
 
           public:
+            ~WinSound();
             static std::shared_ptr<WinSound> createInstance();
 
             bool isVBCableProperlySetup();
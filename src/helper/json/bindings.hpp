@@ -6,6 +6,64 @@
 
 namespace nlohmann
 {
+    //* Leaves the member as it is if the key is missing or holds a different type, so older configs still load
+    template <typename T> void get_to_safe(const json &j, const std::string &key, T &member) noexcept
+    {
+        if (j.find(key) != j.end())
+        {
+            if (j.at(key).type_name() == nlohmann::basic_json(T{}).type_name())
+            {
+                j.at(key).get_to(member);
+            }
+        }
+    }
+
+    template <> struct adl_serializer<Soundux::Objects::LoopRegion>
+    {
+        static void to_json(json &j, const Soundux::Objects::LoopRegion &obj)
+        {
+            j = {{"start", obj.start}, {"end", obj.end}, {"crossfade", obj.crossfade}};
+        }
+        static void from_json(const json &j, Soundux::Objects::LoopRegion &obj)
+        {
+            get_to_safe(j, "start", obj.start);
+            get_to_safe(j, "end", obj.end);
+            get_to_safe(j, "crossfade", obj.crossfade);
+        }
+    };
+    template <> struct adl_serializer<Soundux::Objects::Loudness>
+    {
+        static void to_json(json &j, const Soundux::Objects::Loudness &obj)
+        {
+            j = {{"truePeak", obj.truePeak}, {"integrated", obj.integrated}};
+        }
+        static void from_json(const json &j, Soundux::Objects::Loudness &obj)
+        {
+            get_to_safe(j, "truePeak", obj.truePeak);
+            get_to_safe(j, "integrated", obj.integrated);
+        }
+    };
+    template <> struct adl_serializer<Soundux::Objects::Metadata>
+    {
+        static void to_json(json &j, const Soundux::Objects::Metadata &obj)
+        {
+            j = {
+                {"codec", obj.codec},
+                {"frames", obj.frames},
+                {"bitrate", obj.bitrate},
+                {"channels", obj.channels},
+                {"sampleRate", obj.sampleRate},
+            };
+        }
+        static void from_json(const json &j, Soundux::Objects::Metadata &obj)
+        {
+            get_to_safe(j, "codec", obj.codec);
+            get_to_safe(j, "frames", obj.frames);
+            get_to_safe(j, "bitrate", obj.bitrate);
+            get_to_safe(j, "channels", obj.channels);
+            get_to_safe(j, "sampleRate", obj.sampleRate);
+        }
+    };
     template <> struct adl_serializer<Soundux::Objects::Sound>
     {
         static void to_json(json &j, const Soundux::Objects::Sound &obj)
@@ -17,6 +75,7 @@ namespace nlohmann
                  Soundux::Globals::gHotKeys.getKeySequence(obj.hotkeys)}, //* For frontend and config readability
                 {"id", obj.id},
                 {"path", obj.path},
+                {"priority", obj.priority},
                 {"isFavorite", obj.isFavorite},
                 {"modifiedDate", obj.modifiedDate},
             };
@@ -37,6 +96,30 @@ namespace nlohmann
             {
                 j["remoteVolume"] = nullptr;
             }
+            if (obj.loop)
+            {
+                j["loop"] = *obj.loop;
+            }
+            else
+            {
+                j["loop"] = nullptr;
+            }
+            if (obj.loudness)
+            {
+                j["loudness"] = *obj.loudness;
+            }
+            else
+            {
+                j["loudness"] = nullptr;
+            }
+            if (obj.metadata)
+            {
+                j["metadata"] = *obj.metadata;
+            }
+            else
+            {
+                j["metadata"] = nullptr;
+            }
         }
         static void from_json(const json &j, Soundux::Objects::Sound &obj)
         {
@@ -49,6 +132,7 @@ namespace nlohmann
             {
                 j.at("isFavorite").get_to(obj.isFavorite);
             }
+            get_to_safe(j, "priority", obj.priority);
             if (j.find("localVolume") != j.end())
             {
                 if (j.at("localVolume").is_number())
@@ -63,6 +147,39 @@ namespace nlohmann
                     obj.remoteVolume = j.at("remoteVolume").get<int>();
                 }
             }
+            if (j.find("loop") != j.end())
+            {
+                if (j.at("loop").is_object())
+                {
+                    obj.loop = j.at("loop").get<Soundux::Objects::LoopRegion>();
+                }
+            }
+            if (j.find("loudness") != j.end())
+            {
+                if (j.at("loudness").is_object())
+                {
+                    obj.loudness = j.at("loudness").get<Soundux::Objects::Loudness>();
+                }
+            }
+            if (j.find("metadata") != j.end())
+            {
+                if (j.at("metadata").is_object())
+                {
+                    obj.metadata = j.at("metadata").get<Soundux::Objects::Metadata>();
+                }
+            }
+        }
+    };
+    template <> struct adl_serializer<Soundux::Objects::WaveformLevel>
+    {
+        static void to_json(json &j, const Soundux::Objects::WaveformLevel &obj)
+        {
+            j = {
+                {"peaks", obj.peaks},
+                {"frames", obj.frames},
+                {"sampleRate", obj.sampleRate},
+                {"bucketFrames", obj.bucketFrames},
+            };
         }
     };
     template <> struct adl_serializer<Soundux::Objects::AudioDevice>
@@ -77,6 +194,43 @@ namespace nlohmann
             j.at("isDefault").get_to(obj.isDefault);
         }
     };
+    template <> struct adl_serializer<Soundux::Objects::OutputInfo>
+    {
+        static void to_json(json &j, const Soundux::Objects::OutputInfo &obj)
+        {
+            j = {
+                {"name", obj.name},
+                {"periods", obj.periods},
+                {"latency", obj.latency},
+                {"exclusive", obj.exclusive},
+                {"callbacks", obj.callbacks},
+                {"sampleRate", obj.sampleRate},
+                {"periodSize", obj.periodSize},
+                {"callbackTime", obj.callbackTime},
+                {"gainReduction", obj.gainReduction},
+                {"limitedPeriods", obj.limitedPeriods},
+            };
+        }
+    };
+    template <> struct adl_serializer<Soundux::Objects::OutputDiagnostics>
+    {
+        static void to_json(json &j, const Soundux::Objects::OutputDiagnostics &obj)
+        {
+            j = {
+                {"name", obj.name},
+                {"deadline", obj.deadline},
+                {"callbacks", obj.callbacks},
+                {"underruns", obj.underruns},
+                {"histogram", obj.histogram},
+                {"framesStarved", obj.framesStarved},
+                {"worstCallback", obj.worstCallback},
+                {"deadlineMisses", obj.deadlineMisses},
+                {"histogramStart", obj.histogramStart},
+                {"framesRequested", obj.framesRequested},
+                {"averageCallback", obj.averageCallback},
+            };
+        }
+    };
     template <> struct adl_serializer<Soundux::Objects::PlayingSound>
     {
         static void to_json(json &j, const Soundux::Objects::PlayingSound &obj)
@@ -109,53 +263,88 @@ namespace nlohmann
                 {"theme", obj.theme},
                 {"outputs", obj.outputs},
                 {"viewMode", obj.viewMode},
+                {"maxVoices", obj.maxVoices},
+                {"duckAmount", obj.duckAmount},
+                {"duckAttack", obj.duckAttack},
                 {"stopHotkey", obj.stopHotkey},
+                {"periodSize", obj.periodSize},
+                {"sampleRate", obj.sampleRate},
                 {"syncVolumes", obj.syncVolumes},
                 {"selectedTab", obj.selectedTab},
                 {"localVolume", obj.localVolume},
+                {"periodCount", obj.periodCount},
+                {"limiterMode", obj.limiterMode},
+                {"duckRelease", obj.duckRelease},
                 {"remoteVolume", obj.remoteVolume},
                 {"audioBackend", obj.audioBackend},
+                {"pcmCacheSize", obj.pcmCacheSize},
+                {"fadeDuration", obj.fadeDuration},
                 {"deleteToTrash", obj.deleteToTrash},
+                {"exclusiveMode", obj.exclusiveMode},
+                {"voiceStealing", obj.voiceStealing},
+                {"limiterAttack", obj.limiterAttack},
                 {"pushToTalkKeys", obj.pushToTalkKeys},
+                {"loudnessTarget", obj.loudnessTarget},
+                {"limiterRelease", obj.limiterRelease},
+                {"limiterCeiling", obj.limiterCeiling},
                 {"tabHotkeysOnly", obj.tabHotkeysOnly},
                 {"minimizeToTray", obj.minimizeToTray},
+                {"duckMicrophone", obj.duckMicrophone},
+                {"streamThreshold", obj.streamThreshold},
+                {"pipeWireQuantum", obj.pipeWireQuantum},
+                {"resampleQuality", obj.resampleQuality},
                 {"allowOverlapping", obj.allowOverlapping},
+                {"progressInterval", obj.progressInterval},
+                {"normalizeLoudness", obj.normalizeLoudness},
                 {"muteDuringPlayback", obj.muteDuringPlayback},
                 {"useAsDefaultDevice", obj.useAsDefaultDevice},
                 {"allowMultipleOutputs", obj.allowMultipleOutputs},
+                {"matchDeviceSampleRate", obj.matchDeviceSampleRate},
             };
         }
 
-        template <typename T> static void get_to_safe(const json &j, const std::string &key, T &member) noexcept
-        {
-            if (j.find(key) != j.end())
-            {
-                if (j.at(key).type_name() == nlohmann::basic_json(T{}).type_name())
-                {
-                    j.at(key).get_to(member);
-                }
-            }
-        }
-
         static void from_json(const json &j, Soundux::Objects::Settings &obj)
         {
             get_to_safe(j, "theme", obj.theme);
             get_to_safe(j, "outputs", obj.outputs);
             get_to_safe(j, "viewMode", obj.viewMode);
+            get_to_safe(j, "maxVoices", obj.maxVoices);
+            get_to_safe(j, "duckAmount", obj.duckAmount);
+            get_to_safe(j, "duckAttack", obj.duckAttack);
             get_to_safe(j, "stopHotkey", obj.stopHotkey);
+            get_to_safe(j, "periodSize", obj.periodSize);
+            get_to_safe(j, "sampleRate", obj.sampleRate);
             get_to_safe(j, "localVolume", obj.localVolume);
             get_to_safe(j, "selectedTab", obj.selectedTab);
             get_to_safe(j, "syncVolumes", obj.syncVolumes);
+            get_to_safe(j, "periodCount", obj.periodCount);
+            get_to_safe(j, "limiterMode", obj.limiterMode);
+            get_to_safe(j, "duckRelease", obj.duckRelease);
             get_to_safe(j, "audioBackend", obj.audioBackend);
             get_to_safe(j, "remoteVolume", obj.remoteVolume);
+            get_to_safe(j, "pcmCacheSize", obj.pcmCacheSize);
+            get_to_safe(j, "fadeDuration", obj.fadeDuration);
             get_to_safe(j, "deleteToTrash", obj.deleteToTrash);
+            get_to_safe(j, "exclusiveMode", obj.exclusiveMode);
+            get_to_safe(j, "voiceStealing", obj.voiceStealing);
+            get_to_safe(j, "limiterAttack", obj.limiterAttack);
             get_to_safe(j, "pushToTalkKeys", obj.pushToTalkKeys);
+            get_to_safe(j, "loudnessTarget", obj.loudnessTarget);
+            get_to_safe(j, "limiterRelease", obj.limiterRelease);
+            get_to_safe(j, "limiterCeiling", obj.limiterCeiling);
             get_to_safe(j, "minimizeToTray", obj.minimizeToTray);
             get_to_safe(j, "tabHotkeysOnly", obj.tabHotkeysOnly);
+            get_to_safe(j, "duckMicrophone", obj.duckMicrophone);
+            get_to_safe(j, "streamThreshold", obj.streamThreshold);
+            get_to_safe(j, "pipeWireQuantum", obj.pipeWireQuantum);
+            get_to_safe(j, "resampleQuality", obj.resampleQuality);
             get_to_safe(j, "allowOverlapping", obj.allowOverlapping);
+            get_to_safe(j, "progressInterval", obj.progressInterval);
+            get_to_safe(j, "normalizeLoudness", obj.normalizeLoudness);
             get_to_safe(j, "useAsDefaultDevice", obj.useAsDefaultDevice);
             get_to_safe(j, "muteDuringPlayback", obj.muteDuringPlayback);
             get_to_safe(j, "allowMultipleOutputs", obj.allowMultipleOutputs);
+            get_to_safe(j, "matchDeviceSampleRate", obj.matchDeviceSampleRate);
         }
     };
     template <> struct adl_serializer<Soundux::Objects::Tab>
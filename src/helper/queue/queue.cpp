@@ -1,51 +1,201 @@
 #include "queue.hpp"
+#include <algorithm>
 
 namespace Soundux::Objects
 {
-    void Queue::handle()
+    void Queue::handle(Lane lane)
+    {
+        auto &state = lanes[static_cast<std::size_t>(lane)];
+
+        std::unique_lock lock(queueMutex);
+        while (true)
+        {
+            state.cv.wait(lock, [&]() { return !state.tasks.empty() || stop; });
+
+            //* Control tasks are still run on shutdown, pending background work is dropped
+            if (stop && (lane == Lane::Background || state.tasks.empty()))
+            {
+                break;
+            }
+
+            auto task = state.tasks.extract(state.tasks.begin());
+            state.running.emplace(task.key());
+
+            const auto started = std::chrono::steady_clock::now();
+            const std::uint64_t wait =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(started - task.mapped().pushed).count();
+
+            lock.unlock();
+            task.mapped().function();
+            const std::uint64_t run =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started)
+                    .count();
+            lock.lock();
+
+            state.running.erase(task.key());
+            state.completed++;
+            state.waitTime += wait;
+            state.worstWait = std::max(state.worstWait, wait);
+            state.runTime += run;
+        }
+    }
+
+    void Queue::schedule()
     {
         std::unique_lock lock(queueMutex);
         while (!stop)
         {
-            cv.wait(lock, [&]() { return !queue.empty() || stop; });
-            while (!queue.empty())
+            if (timers.empty())
             {
-                auto front = std::move(*queue.begin());
+                timerCv.wait(lock);
+            }
+            else
+            {
+                //* Copied, arming a timer while we wait may reallocate the heap
+                const auto next = timers.top().due;
+                timerCv.wait_until(lock, next);
+            }
+
+            std::vector<Timer> due;
+            const auto now = std::chrono::steady_clock::now();
+            while (!stop && !timers.empty() && timers.top().due <= now)
+            {
+                auto timer = timers.top();
+                timers.pop();
 
-                lock.unlock();
-                front.second();
-                lock.lock();
+                if (*timer.cancelled)
+                {
+                    continue;
+                }
+                if (timer.interval.count() > 0)
+                {
+                    //* Ticks that were missed are skipped instead of fired all at once
+                    auto next = timer;
+                    while (next.due <= now)
+                    {
+                        next.due += next.interval;
+                    }
+                    timers.push(std::move(next));
+                }
 
-                queue.erase(front.first);
+                due.emplace_back(std::move(timer));
+            }
+
+            lock.unlock();
+            for (auto &timer : due)
+            {
+                push_unique(timer.id, std::move(timer.function), timer.lane);
             }
+            lock.lock();
         }
     }
 
-    void Queue::push_unique(std::uint64_t id, std::function<void()> function)
+    std::shared_ptr<std::atomic<bool>> Queue::arm(std::uint64_t id, std::chrono::milliseconds delay,
+                                                  std::chrono::milliseconds interval, std::function<void()> function,
+                                                  Lane lane)
     {
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        auto task = [cancelled, function = std::move(function)] {
+            if (!*cancelled)
+            {
+                function();
+            }
+        };
+
         {
             std::lock_guard lock(queueMutex);
-            if (queue.find(id) != queue.end())
+            timers.push({std::chrono::steady_clock::now() + delay, interval, lane, id, std::move(task), cancelled});
+        }
+        timerCv.notify_one();
+
+        return cancelled;
+    }
+    std::shared_ptr<std::atomic<bool>> Queue::push_after(std::uint64_t id, std::chrono::milliseconds delay,
+                                                         std::function<void()> function, Lane lane)
+    {
+        return arm(id, delay, std::chrono::milliseconds(0), std::move(function), lane);
+    }
+    std::shared_ptr<std::atomic<bool>> Queue::push_every(std::uint64_t id, std::chrono::milliseconds interval,
+                                                         std::function<void()> function, Lane lane)
+    {
+        interval = std::max(interval, std::chrono::milliseconds(1));
+        return arm(id, interval, interval, std::move(function), lane);
+    }
+
+    Queue::Result Queue::push_unique(std::uint64_t id, std::function<void()> function, Lane lane)
+    {
+        auto &state = lanes[static_cast<std::size_t>(lane)];
+        {
+            std::lock_guard lock(queueMutex);
+            if (state.tasks.find(id) != state.tasks.end() || state.running.find(id) != state.running.end())
             {
-                return;
+                state.deduplicated++;
+                return Result::Pending;
             }
+            //* The caller is usually the ui, so a full lane rejects the task instead of blocking
+            if (state.tasks.size() >= state.capacity)
+            {
+                state.rejected++;
+                return Result::Full;
+            }
+
+            state.tasks.emplace(id, Task{std::move(function), std::chrono::steady_clock::now()});
         }
 
-        std::unique_lock lock(queueMutex);
-        queue.emplace(id, std::move(function));
-        lock.unlock();
+        state.cv.notify_one();
+        return Result::Queued;
+    }
+
+    QueueStats Queue::getStats(Lane lane)
+    {
+        auto &state = lanes[static_cast<std::size_t>(lane)];
+        std::lock_guard lock(queueMutex);
 
-        cv.notify_one();
+        QueueStats rtn;
+        rtn.pending = state.tasks.size();
+        rtn.completed = state.completed;
+        rtn.rejected = state.rejected;
+        rtn.deduplicated = state.deduplicated;
+
+        const auto completed = static_cast<double>(std::max<std::uint64_t>(state.completed, 1));
+        rtn.averageWait = static_cast<double>(state.waitTime) / 1000.0 / completed;
+        rtn.worstWait = static_cast<double>(state.worstWait) / 1000.0;
+        rtn.averageRun = static_cast<double>(state.runTime) / 1000.0 / completed;
+
+        return rtn;
     }
 
     Queue::Queue()
     {
-        handler = std::thread([this] { handle(); });
+        //* Background tasks are deduplicated per sound, so this only has to hold a few very large tabs
+        lanes[static_cast<std::size_t>(Lane::Control)].capacity = 256;
+        lanes[static_cast<std::size_t>(Lane::Background)].capacity = 1u << 16;
+
+        lanes[static_cast<std::size_t>(Lane::Control)].workers.emplace_back([this] { handle(Lane::Control); });
+        for (int i = 0; 2 > i; i++)
+        {
+            lanes[static_cast<std::size_t>(Lane::Background)].workers.emplace_back(
+                [this] { handle(Lane::Background); });
+        }
+        scheduler = std::thread([this] { schedule(); });
     }
     Queue::~Queue()
     {
-        stop = true;
-        cv.notify_all();
-        handler.join();
+        {
+            std::lock_guard lock(queueMutex);
+            stop = true;
+        }
+
+        timerCv.notify_all();
+        scheduler.join();
+
+        for (auto &state : lanes)
+        {
+            state.cv.notify_all();
+            for (auto &worker : state.workers)
+            {
+                worker.join();
+            }
+        }
     }
-} // namespace Soundux::Objects
\ No newline at end of file
+} // namespace Soundux::Objects
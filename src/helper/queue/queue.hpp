@@ -1,32 +1,140 @@
 #pragma once
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
+#include <set>
 #include <thread>
+#include <vector>
 
 namespace Soundux
 {
     namespace Objects
     {
+        struct QueueStats
+        {
+            std::uint64_t pending;
+            std::uint64_t completed;
+            std::uint64_t rejected;     //* Pushes that found the lane full
+            std::uint64_t deduplicated; //* Pushes of an id that was already pending or running
+
+            //* In microseconds, waiting is the time from being pushed until a worker picked the task up
+            double averageWait;
+            double worstWait;
+            double averageRun;
+        };
+
         class Queue
         {
-            std::map<std::uint64_t, std::function<void()>> queue;
+          public:
+            enum class Lane : std::uint8_t
+            {
+                Control,    //* Stopping sounds or downloads and device changes, never waits behind background work
+                Background, //* Decoding and analysis, may take seconds per task
+            };
+            //* Every kind of task that is queued. Lower ids run first within a lane, the task type makes up the upper
+            //* half of the id and tasks that belong to a sound carry its id in the lower half.
+            enum class TaskType : std::uint32_t
+            {
+                StopAll,
+                RefreshDevices,
+                KillDownload,
+                LogDiagnostics,
+                Preload,
+                SeekTable,
+                RequestWaveform,
+                ProbeMetadata,
+                MeasureLoudness,
+                GenerateWaveform,
+            };
+            enum class Result : std::uint8_t
+            {
+                Queued,
+                Pending, //* A task with the same id is already pending or running
+                Full,
+            };
+
+            static std::uint64_t taskId(TaskType type, std::uint32_t sound = 0)
+            {
+                return (static_cast<std::uint64_t>(type) << 32) | sound;
+            }
+
+          private:
+            struct Task
+            {
+                std::function<void()> function;
+                std::chrono::steady_clock::time_point pushed;
+            };
+            struct LaneState
+            {
+                std::size_t capacity = 0;
+                std::map<std::uint64_t, Task> tasks; //* Lower ids run first
+                std::set<std::uint64_t> running;
+
+                std::condition_variable cv;
+                std::vector<std::thread> workers;
+
+                std::uint64_t completed = 0;
+                std::uint64_t rejected = 0;
+                std::uint64_t deduplicated = 0;
+                std::uint64_t waitTime = 0; //* In nanoseconds, summed up over all completed tasks
+                std::uint64_t worstWait = 0;
+                std::uint64_t runTime = 0;
+            };
+
+            struct Timer
+            {
+                std::chrono::steady_clock::time_point due;
+                std::chrono::milliseconds interval; //* Zero for timers that only fire once
+
+                Lane lane;
+                std::uint64_t id;
+                std::function<void()> function;
+                std::shared_ptr<std::atomic<bool>> cancelled;
+            };
+            struct Later
+            {
+                bool operator()(const Timer &left, const Timer &right) const
+                {
+                    return left.due > right.due;
+                }
+            };
+
+            std::array<LaneState, 2> lanes;
             std::mutex queueMutex;
+            std::atomic<bool> stop = false;
 
-            std::condition_variable cv;
-            std::atomic<bool> stop;
-            std::thread handler;
+            std::priority_queue<Timer, std::vector<Timer>, Later> timers; //* Earliest first
+            std::condition_variable timerCv;
+            std::thread scheduler;
 
           private:
-            void handle();
+            void handle(Lane);
+            void schedule();
+            std::shared_ptr<std::atomic<bool>> arm(std::uint64_t, std::chrono::milliseconds, std::chrono::milliseconds,
+                                                   std::function<void()>, Lane);
 
           public:
             Queue();
             ~Queue();
 
-            void push_unique(std::uint64_t, std::function<void()>);
+            //* Ids that are still pending or running are ignored, just like pushes to a full lane
+            Result push_unique(std::uint64_t, std::function<void()>, Lane = Lane::Background);
+
+            //* Timers hand their task to push_unique once due, so a periodic task that is still pending or running
+            //* skips a tick. Setting the returned token cancels the timer and any of its tasks that did not run yet.
+            std::shared_ptr<std::atomic<bool>> push_after(std::uint64_t, std::chrono::milliseconds,
+                                                          std::function<void()>, Lane = Lane::Background);
+            std::shared_ptr<std::atomic<bool>> push_every(std::uint64_t, std::chrono::milliseconds,
+                                                          std::function<void()>, Lane = Lane::Background);
+
+            QueueStats getStats(Lane);
         };
     } // namespace Objects
-} // namespace Soundux
\ No newline at end of file
+} // namespace Soundux
@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace Soundux
+{
+    namespace Objects
+    {
+        //* Bounded single-producer/single-consumer queue.
+        //* push() and pop() never block or allocate, which makes it safe to use from the audio thread.
+        template <typename T, std::size_t Capacity> class RingBuffer
+        {
+            static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+
+            std::array<T, Capacity> items;
+            alignas(64) std::atomic<std::size_t> head = 0; //* Next slot to read, owned by the consumer
+            alignas(64) std::atomic<std::size_t> tail = 0; //* Next slot to write, owned by the producer
+
+          public:
+            bool push(const T &item)
+            {
+                const auto currentTail = tail.load(std::memory_order_relaxed);
+                if (currentTail - head.load(std::memory_order_acquire) == Capacity)
+                {
+                    return false;
+                }
+
+                items[currentTail & (Capacity - 1)] = item;
+                tail.store(currentTail + 1, std::memory_order_release);
+
+                return true;
+            }
+            bool pop(T &item)
+            {
+                const auto currentHead = head.load(std::memory_order_relaxed);
+                if (currentHead == tail.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+
+                item = items[currentHead & (Capacity - 1)];
+                head.store(currentHead + 1, std::memory_order_release);
+
+                return true;
+            }
+            std::size_t size() const
+            {
+                return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+            }
+        };
+
+        //* Single-producer/single-consumer queue for bulk data like pcm samples.
+        //* The capacity is chosen at runtime, resize() and clear() may only be called while neither side is using it.
+        template <typename T> class StreamRingBuffer
+        {
+            std::vector<T> items;
+            std::size_t mask = 0;
+            alignas(64) std::atomic<std::size_t> head = 0;
+            alignas(64) std::atomic<std::size_t> tail = 0;
+
+          public:
+            void resize(std::size_t capacity)
+            {
+                std::size_t size = 1;
+                while (size < capacity)
+                {
+                    size <<= 1;
+                }
+
+                if (items.size() != size)
+                {
+                    items.assign(size, T{});
+                    mask = size - 1;
+                }
+                clear();
+            }
+            void clear()
+            {
+                head = 0;
+                tail = 0;
+            }
+
+            std::size_t write(const T *data, std::size_t count)
+            {
+                const auto currentTail = tail.load(std::memory_order_relaxed);
+                count = std::min(count, items.size() - (currentTail - head.load(std::memory_order_acquire)));
+
+                for (std::size_t i = 0; count > i; i++)
+                {
+                    items[(currentTail + i) & mask] = data[i];
+                }
+                tail.store(currentTail + count, std::memory_order_release);
+
+                return count;
+            }
+            std::size_t read(T *data, std::size_t count)
+            {
+                const auto currentHead = head.load(std::memory_order_relaxed);
+                count = std::min(count, tail.load(std::memory_order_acquire) - currentHead);
+
+                for (std::size_t i = 0; count > i; i++)
+                {
+                    data[i] = items[(currentHead + i) & mask];
+                }
+                head.store(currentHead + count, std::memory_order_release);
+
+                return count;
+            }
+            void discard()
+            {
+                head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+            }
+
+            std::size_t readable() const
+            {
+                return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+            }
+            std::size_t writable() const
+            {
+                return items.size() - readable();
+            }
+        };
+    } // namespace Objects
+} // namespace Soundux
@@ -72,6 +72,7 @@ int main(int argc, char **arguments)
     }
 
     gConfig.load();
+    gData.setRegistry(&gSounds);
     gData.set(gConfig.data);
     gSettings = gConfig.settings;
 
@@ -112,6 +113,7 @@ int main(int argc, char **arguments)
 
     gGui->mainLoop();
 
+    gWaveforms.destroy();
     gAudio.destroy();
 #if defined(__linux__)
     if (gAudioBackend)
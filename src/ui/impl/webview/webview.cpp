@@ -1,4 +1,5 @@
 #include "webview.hpp"
+#include <atomic>
 #include <core/global/globals.hpp>
 #include <cstdint>
 #include <fancy.hpp>
@@ -81,6 +82,8 @@ namespace Soundux::Objects
     void WebView::exposeFunctions()
     {
         webview->expose(Webview::Function("getSettings", []() { return Globals::gSettings; }));
+        webview->expose(Webview::Function("getOutputInfo", []() { return Globals::gAudio.getOutputInfo(); }));
+        webview->expose(Webview::Function("getDiagnostics", []() { return Globals::gAudio.getDiagnostics(); }));
         webview->expose(Webview::Function("isLinux", []() {
 #if defined(__linux__)
             return true;
@@ -149,11 +152,20 @@ namespace Soundux::Objects
                 promise.resolve(Globals::gYtdl.download(url));
             }));
         webview->expose(Webview::AsyncFunction("stopYoutubeDLDownload", [this](Webview::Promise promise) {
-            std::thread killDownload([promise, this] {
+            //* Every call gets its own task so that each promise is only settled once a kill actually ran, killing a
+            //* download that is already gone returns right away
+            static std::atomic<std::uint32_t> kills = 0;
+            auto killDownload = [promise, this] {
                 Globals::gYtdl.killDownload();
                 promise.discard();
-            });
-            killDownload.detach();
+            };
+
+            //* Stopping is short and asked for by the user, so it does not wait behind background decodes
+            if (Globals::gQueue.push_unique(Queue::taskId(Queue::TaskType::KillDownload, kills++), killDownload,
+                                            Queue::Lane::Control) != Queue::Result::Queued)
+            {
+                promise.discard();
+            }
         }));
         webview->expose(Webview::Function("getSystemInfo", []() -> std::string { return SystemInfo::getSummary(); }));
         webview->expose(Webview::AsyncFunction(
@@ -168,10 +180,22 @@ namespace Soundux::Objects
                                           [this](const std::uint32_t &id, const std::optional<int> &volume) {
                                               return setCustomRemoteVolume(id, volume);
                                           }));
+        webview->expose(Webview::Function("setSoundPriority", [this](const std::uint32_t &id, int priority) {
+            return setSoundPriority(id, priority);
+        }));
+        webview->expose(Webview::Function(
+            "setLoopRegion", [this](const std::uint32_t &id, std::uint64_t start, std::uint64_t end,
+                                    std::uint64_t crossfade) { return setLoopRegion(id, start, end, crossfade); }));
+        webview->expose(
+            Webview::Function("clearLoopRegion", [this](const std::uint32_t &id) { return clearLoopRegion(id); }));
         webview->expose(Webview::Function("toggleSoundPlayback", [this]() { return toggleSoundPlayback(); }));
+        webview->expose(Webview::Function("getWaveform", [this](const std::uint32_t &id, std::uint32_t width) {
+            return getWaveform(id, width);
+        }));
 
 #if !defined(__linux__)
         webview->expose(Webview::Function("getOutputs", [this]() { return getOutputs(); }));
+        webview->expose(Webview::Function("refreshDevices", []() { return Globals::gAudio.refreshDevices(); }));
 #endif
 #if defined(_WIN32)
         webview->expose(Webview::Function("openUrl", [](const std::string &url) {
@@ -300,6 +324,9 @@ namespace Soundux::Objects
     void WebView::fetchTranslations()
     {
         webview->setNavigateCallback([this]([[maybe_unused]] const std::string &url) {
+            //* Progress is sent in one call per tick, the frontend still handles one sound at a time
+            webview->runCode("window.updateSounds = (sounds) => sounds.forEach((sound) => window.updateSound(sound));");
+
             static bool once = false;
             if (!once)
             {
@@ -409,9 +436,9 @@ namespace Soundux::Objects
     {
         webview->callFunction<void>(Webview::JavaScriptFunction("window.onSoundPlayed", sound));
     }
-    void WebView::onSoundProgressed(const PlayingSound &sound)
+    void WebView::onSoundsProgressed(const std::vector<PlayingSound> &sounds)
     {
-        webview->callFunction<void>(Webview::JavaScriptFunction("window.updateSound", sound));
+        webview->callFunction<void>(Webview::JavaScriptFunction("window.updateSounds", sounds));
     }
     void WebView::onDownloadProgressed(float progress, const std::string &eta)
     {
@@ -35,7 +35,7 @@ namespace Soundux
             void onSwitchOnConnectDetected(bool state) override;
             void onError(const Enums::ErrorCode &error) override;
             void onSoundPlayed(const PlayingSound &sound) override;
-            void onSoundProgressed(const PlayingSound &sound) override;
+            void onSoundsProgressed(const std::vector<PlayingSound> &sounds) override;
             void onDownloadProgressed(float progress, const std::string &eta) override;
         };
     } // namespace Objects
@@ -12,6 +12,14 @@
 
 namespace Soundux::Objects
 {
+    std::vector<Sound> getHotSounds(const std::vector<Sound> &sounds)
+    {
+        std::vector<Sound> rtn;
+        std::copy_if(sounds.begin(), sounds.end(), std::back_inserter(rtn),
+                     [](const auto &sound) { return sound.isFavorite || !sound.hotkeys.empty(); });
+
+        return rtn;
+    }
     void Window::setup()
     {
         NFD::Init();
@@ -19,7 +27,11 @@ namespace Soundux::Objects
         for (auto &tab : Globals::gData.getTabs())
         {
             tab.sounds = getTabContent(tab);
+            Globals::gWaveforms.cancel(tab);
             Globals::gData.setTab(tab.id, tab);
+            Globals::gAudio.preload(getHotSounds(tab.sounds));
+            Globals::gAudio.analyze(tab.sounds);
+            Globals::gWaveforms.generate(tab);
         }
     }
     Window::~Window()
@@ -88,6 +100,14 @@ namespace Soundux::Objects
                     sound.isFavorite = oldSound->isFavorite;
                     sound.localVolume = oldSound->localVolume;
                     sound.remoteVolume = oldSound->remoteVolume;
+                    sound.priority = oldSound->priority;
+                    sound.loop = oldSound->loop;
+
+                    if (oldSound->modifiedDate == sound.modifiedDate)
+                    {
+                        sound.loudness = oldSound->loudness;
+                        sound.metadata = oldSound->metadata;
+                    }
                 }
                 else
                 {
@@ -195,6 +215,12 @@ namespace Soundux::Objects
                     }
                 }
 
+                for (const auto &tab : tabs)
+                {
+                    Globals::gAudio.analyze(tab.sounds);
+                    Globals::gWaveforms.generate(tab);
+                }
+
                 return tabs;
             }
             Fancy::fancy.logTime().warning() << "Selected Folder does not exist!" << std::endl;
@@ -213,7 +239,8 @@ namespace Soundux::Objects
             {
                 stopSounds(true);
             }
-            if (Globals::gSettings.muteDuringPlayback)
+            //* While ducking, the microphone is lowered in the mixer instead
+            if (Globals::gSettings.muteDuringPlayback && !Globals::gAudio.isDucking())
             {
                 if (Globals::gAudioBackend)
                 {
@@ -228,13 +255,12 @@ namespace Soundux::Objects
                 Globals::gHotKeys.pressKeys(Globals::gSettings.pushToTalkKeys);
             }
 
-            auto playingSound = Globals::gAudio.play(*sound);
-            auto remotePlayingSound = Globals::gAudio.play(*sound, Globals::gAudio.nullSink);
+            //* The null sink is fed from the same voice, so local and remote playback stay in sync
+            auto playingSound = Globals::gAudio.play(*sound, Globals::gAudio.nullSink);
 
-            if (playingSound && remotePlayingSound)
+            if (playingSound)
             {
-                groupedSounds->insert({playingSound->id, remotePlayingSound->id});
-                if (Globals::gSettings.outputs.empty() && playingSound)
+                if (Globals::gSettings.outputs.empty())
                 {
                     return *playingSound;
                 }
@@ -251,10 +277,7 @@ namespace Soundux::Objects
 
                     if (!moveSuccess)
                     {
-                        if (playingSound)
-                            stopSound(playingSound->id);
-                        if (remotePlayingSound)
-                            stopSound(remotePlayingSound->id);
+                        stopSound(playingSound->id);
 
                         onError(Enums::ErrorCode::FailedToMoveToSink);
                         return std::nullopt;
@@ -305,30 +328,26 @@ namespace Soundux::Objects
                 return Globals::gAudio.play(*sound);
             }
 
-            auto playingSound = Globals::gAudio.play(*sound);
+            std::optional<PlayingSound> playingSound;
             auto playbackDevice = Globals::gAudio.getAudioDevice(Globals::gSettings.outputs.front());
 
             if (playbackDevice && !playbackDevice->isDefault)
             {
-                auto remotePlayingSound = Globals::gAudio.play(*sound, playbackDevice);
-                if (playingSound && remotePlayingSound)
-                {
-                    groupedSounds->insert({playingSound->id, remotePlayingSound->id});
-                    return *playingSound;
-                }
-
-                if (playingSound)
-                    stopSound(playingSound->id);
-
-                if (remotePlayingSound)
-                    stopSound(remotePlayingSound->id);
+                playingSound = Globals::gAudio.play(*sound, playbackDevice);
+            }
+            else
+            {
+                playingSound = Globals::gAudio.play(*sound);
+            }
 
-                Fancy::fancy.logTime().failure() << "Failed to play sound " << id << std::endl;
-                onError(Enums::ErrorCode::FailedToPlay);
-                return std::nullopt;
+            if (playingSound)
+            {
+                return *playingSound;
             }
 
-            return *playingSound;
+            Fancy::fancy.logTime().failure() << "Failed to play sound " << id << std::endl;
+            onError(Enums::ErrorCode::FailedToPlay);
+            return std::nullopt;
         }
 
         Fancy::fancy.logTime().failure() << "Sound " << id << " not found" << std::endl;
@@ -338,28 +357,7 @@ namespace Soundux::Objects
 #endif
     std::optional<PlayingSound> Window::pauseSound(const std::uint32_t &id)
     {
-        std::optional<std::uint32_t> remoteSoundId;
-        if (!Globals::gSettings.outputs.empty() && !Globals::gSettings.useAsDefaultDevice)
-        {
-            auto scoped = groupedSounds.scoped();
-            if (scoped->find(id) == scoped->end())
-            {
-                if (!Globals::gSettings.outputs.empty() || !Globals::gSettings.useAsDefaultDevice)
-                {
-                    Fancy::fancy.logTime().warning() << "Failed to find remoteSound of sound " << id << std::endl;
-                }
-            }
-            else
-            {
-                remoteSoundId = scoped->at(id);
-            }
-        }
         auto playingSound = Globals::gAudio.pause(id);
-        if (remoteSoundId)
-        {
-            Globals::gAudio.pause(*remoteSoundId);
-        }
-
         if (playingSound)
         {
             return *playingSound;
@@ -371,28 +369,7 @@ namespace Soundux::Objects
     }
     std::optional<PlayingSound> Window::resumeSound(const std::uint32_t &id)
     {
-        std::optional<std::uint32_t> remoteSoundId;
-        if (!Globals::gSettings.outputs.empty() && !Globals::gSettings.useAsDefaultDevice)
-        {
-            auto scoped = groupedSounds.scoped();
-            if (scoped->find(id) == scoped->end())
-            {
-                if (!Globals::gSettings.outputs.empty() || !Globals::gSettings.useAsDefaultDevice)
-                {
-                    Fancy::fancy.logTime().warning() << "Failed to find remoteSound of sound " << id << std::endl;
-                }
-            }
-            else
-            {
-                remoteSoundId = scoped->at(id);
-            }
-        }
         auto playingSound = Globals::gAudio.resume(id);
-        if (remoteSoundId)
-        {
-            Globals::gAudio.resume(*remoteSoundId);
-        }
-
         if (playingSound)
         {
             return *playingSound;
@@ -404,28 +381,7 @@ namespace Soundux::Objects
     }
     std::optional<PlayingSound> Window::seekSound(const std::uint32_t &id, std::uint64_t seekTo)
     {
-        std::optional<std::uint32_t> remoteSoundId;
-        if (!Globals::gSettings.outputs.empty() && !Globals::gSettings.useAsDefaultDevice)
-        {
-            auto scoped = groupedSounds.scoped();
-            if (scoped->find(id) == scoped->end())
-            {
-                if (!Globals::gSettings.outputs.empty() || !Globals::gSettings.useAsDefaultDevice)
-                {
-                    Fancy::fancy.logTime().warning() << "Failed to find remoteSound of sound " << id << std::endl;
-                }
-            }
-            else
-            {
-                remoteSoundId = scoped->at(id);
-            }
-        }
         auto playingSound = Globals::gAudio.seek(id, seekTo);
-        if (remoteSoundId)
-        {
-            Globals::gAudio.seek(*remoteSoundId, seekTo);
-        }
-
         if (playingSound)
         {
             return *playingSound;
@@ -437,28 +393,7 @@ namespace Soundux::Objects
     }
     std::optional<PlayingSound> Window::repeatSound(const std::uint32_t &id, bool shouldRepeat)
     {
-        std::optional<std::uint32_t> remoteSoundId;
-        if (!Globals::gSettings.outputs.empty() && !Globals::gSettings.useAsDefaultDevice)
-        {
-            auto scoped = groupedSounds.scoped();
-            if (scoped->find(id) == scoped->end())
-            {
-                if (!Globals::gSettings.outputs.empty() || !Globals::gSettings.useAsDefaultDevice)
-                {
-                    Fancy::fancy.logTime().warning() << "Failed to find remoteSound of sound " << id << std::endl;
-                }
-            }
-            else
-            {
-                remoteSoundId = scoped->at(id);
-            }
-        }
         auto playingSound = Globals::gAudio.repeat(id, shouldRepeat);
-        if (remoteSoundId)
-        {
-            Globals::gAudio.repeat(*remoteSoundId, shouldRepeat);
-        }
-
         if (playingSound)
         {
             return *playingSound;
@@ -471,30 +406,16 @@ namespace Soundux::Objects
     }
     std::vector<Tab> Window::removeTab(const std::uint32_t &id)
     {
+        if (auto tab = Globals::gData.getTab(id); tab)
+        {
+            Globals::gWaveforms.cancel(*tab);
+        }
         Globals::gData.removeTabById(id);
         return Globals::gData.getTabs();
     }
     bool Window::stopSound(const std::uint32_t &id)
     {
-        std::optional<std::uint32_t> remoteSoundId;
-        if (!Globals::gSettings.outputs.empty() && !Globals::gSettings.useAsDefaultDevice)
-        {
-            auto scoped = groupedSounds.scoped();
-            if (scoped->find(id) == scoped->end())
-            {
-                Fancy::fancy.logTime().warning() << "Failed to find remoteSound of sound " << id << std::endl;
-                return false;
-            }
-
-            remoteSoundId = scoped->at(id);
-        }
-
         auto status = Globals::gAudio.stop(id);
-        if (remoteSoundId)
-        {
-            Globals::gAudio.stop(*remoteSoundId);
-            groupedSounds->erase(id);
-        }
 
         if (Globals::gAudio.getPlayingSounds().empty())
         {
@@ -507,7 +428,8 @@ namespace Soundux::Objects
     {
         if (!sync)
         {
-            Globals::gQueue.push_unique(0, []() { Globals::gAudio.stopAll(); });
+            Globals::gQueue.push_unique(
+                Queue::taskId(Queue::TaskType::StopAll), []() { Globals::gAudio.stopAll(); }, Queue::Lane::Control);
         }
         else
         {
@@ -515,7 +437,6 @@ namespace Soundux::Objects
         }
 
         onAllSoundsFinished();
-        groupedSounds->clear();
 
 #if defined(__linux__)
         if (Globals::gAudioBackend)
@@ -533,17 +454,16 @@ namespace Soundux::Objects
     }
     std::optional<Sound> Window::setCustomLocalVolume(const std::uint32_t &id, const std::optional<int> &localVolume)
     {
-        auto sound = Globals::gData.getSound(id);
+        auto sound = Globals::gSounds.modify(id, [&](Sound &stored) { stored.localVolume = localVolume; });
         if (sound)
         {
-            sound->get().localVolume = localVolume;
-
-            for (auto &playingSound : Globals::gAudio.getPlayingSounds())
+            for (const auto &playingSound : Globals::gAudio.getPlayingSounds())
             {
-                if (playingSound.sound.id == sound->get().id && playingSound.playbackDevice.isDefault)
+                if (playingSound.sound.id == sound->id)
                 {
-                    playingSound.raw.device.load()->masterVolumeFactor =
-                        static_cast<float>(localVolume ? *localVolume : Globals::gSettings.localVolume) / 100.f;
+                    Globals::gAudio.setLocalVolume(
+                        playingSound.id,
+                        static_cast<float>(localVolume ? *localVolume : Globals::gSettings.localVolume) / 100.f);
                 }
             }
 
@@ -557,17 +477,16 @@ namespace Soundux::Objects
     }
     std::optional<Sound> Window::setCustomRemoteVolume(const std::uint32_t &id, const std::optional<int> &remoteVolume)
     {
-        auto sound = Globals::gData.getSound(id);
+        auto sound = Globals::gSounds.modify(id, [&](Sound &stored) { stored.remoteVolume = remoteVolume; });
         if (sound)
         {
-            sound->get().remoteVolume = remoteVolume;
-
-            for (auto &playingSound : Globals::gAudio.getPlayingSounds())
+            for (const auto &playingSound : Globals::gAudio.getPlayingSounds())
             {
-                if (playingSound.sound.id == sound->get().id && !playingSound.playbackDevice.isDefault)
+                if (playingSound.sound.id == sound->id)
                 {
-                    playingSound.raw.device.load()->masterVolumeFactor =
-                        static_cast<float>(remoteVolume ? *remoteVolume : Globals::gSettings.remoteVolume) / 100.f;
+                    Globals::gAudio.setRemoteVolume(
+                        playingSound.id,
+                        static_cast<float>(remoteVolume ? *remoteVolume : Globals::gSettings.remoteVolume) / 100.f);
                 }
             }
 
@@ -579,8 +498,71 @@ namespace Soundux::Objects
         onError(Enums::ErrorCode::FailedToSetCustomVolume);
         return std::nullopt;
     }
+    std::optional<Sound> Window::setSoundPriority(const std::uint32_t &id, int priority)
+    {
+        auto sound = Globals::gSounds.modify(id, [&](Sound &stored) { stored.priority = priority; });
+        if (sound)
+        {
+            return sound;
+        }
+
+        Fancy::fancy.logTime().failure() << "Failed to set priority for sound " << id << ", sound does not exist"
+                                         << std::endl;
+        onError(Enums::ErrorCode::SoundNotFound);
+        return std::nullopt;
+    }
+    std::optional<Sound> Window::setLoopRegion(const std::uint32_t &id, std::uint64_t start, std::uint64_t end,
+                                               std::uint64_t crossfade)
+    {
+        if (end && end <= start)
+        {
+            Fancy::fancy.logTime().failure() << "Failed to set loop region for sound " << id
+                                             << ", the end has to come after the start" << std::endl;
+            return std::nullopt;
+        }
+
+        auto sound = Globals::gSounds.modify(id, [&](Sound &stored) { stored.loop = {start, end, crossfade}; });
+        if (sound)
+        {
+            return sound;
+        }
+
+        Fancy::fancy.logTime().failure() << "Failed to set loop region for sound " << id << ", sound does not exist"
+                                         << std::endl;
+        onError(Enums::ErrorCode::SoundNotFound);
+        return std::nullopt;
+    }
+    std::optional<Sound> Window::clearLoopRegion(const std::uint32_t &id)
+    {
+        auto sound = Globals::gSounds.modify(id, [&](Sound &stored) { stored.loop.reset(); });
+        if (sound)
+        {
+            return sound;
+        }
+
+        Fancy::fancy.logTime().failure() << "Failed to clear loop region for sound " << id << ", sound does not exist"
+                                         << std::endl;
+        onError(Enums::ErrorCode::SoundNotFound);
+        return std::nullopt;
+    }
+    std::optional<WaveformLevel> Window::getWaveform(const std::uint32_t &id, std::uint32_t width)
+    {
+        auto sound = Globals::gData.getSound(id);
+        if (sound)
+        {
+            //* Empty until the waveform was computed, the frontend asks again later
+            return Globals::gWaveforms.get(*sound, width);
+        }
+
+        Fancy::fancy.logTime().failure() << "Failed to get waveform of sound " << id << ", sound does not exist"
+                                         << std::endl;
+        onError(Enums::ErrorCode::SoundNotFound);
+        return std::nullopt;
+    }
     Settings Window::changeSettings(Settings settings)
     {
+        settings.maxVoices = Audio::clampMaxVoices(settings.maxVoices);
+
         auto oldSettings = Globals::gSettings;
         Globals::gSettings = settings;
 
@@ -589,22 +571,44 @@ namespace Soundux::Objects
         {
             for (const auto &playingSound : Globals::gAudio.getPlayingSounds())
             {
-                int newVolume = 0;
                 const auto &sound = playingSound.sound;
 
-                if (playingSound.playbackDevice.isDefault)
-                {
-                    newVolume = sound.localVolume ? *sound.localVolume : Globals::gSettings.localVolume;
-                }
-                else
-                {
-                    newVolume = sound.remoteVolume ? *sound.remoteVolume : Globals::gSettings.remoteVolume;
-                }
+                auto localVolume = sound.localVolume ? *sound.localVolume : Globals::gSettings.localVolume;
+                auto remoteVolume = sound.remoteVolume ? *sound.remoteVolume : Globals::gSettings.remoteVolume;
 
-                playingSound.raw.device.load()->masterVolumeFactor = static_cast<float>(newVolume) / 100.f;
+                Globals::gAudio.setLocalVolume(playingSound.id, static_cast<float>(localVolume) / 100.f);
+                Globals::gAudio.setRemoteVolume(playingSound.id, static_cast<float>(remoteVolume) / 100.f);
             }
         }
 
+        if (settings.fadeDuration != oldSettings.fadeDuration)
+        {
+            Globals::gAudio.setFadeDuration(settings.fadeDuration);
+        }
+        if (settings.pcmCacheSize != oldSettings.pcmCacheSize)
+        {
+            Globals::gAudio.setCacheSize(settings.pcmCacheSize);
+        }
+        if (settings.streamThreshold != oldSettings.streamThreshold)
+        {
+            Globals::gAudio.setStreamThreshold(settings.streamThreshold);
+        }
+        if (settings.periodSize != oldSettings.periodSize || settings.periodCount != oldSettings.periodCount ||
+            settings.sampleRate != oldSettings.sampleRate || settings.exclusiveMode != oldSettings.exclusiveMode ||
+            settings.matchDeviceSampleRate != oldSettings.matchDeviceSampleRate ||
+            settings.resampleQuality != oldSettings.resampleQuality)
+        {
+            //* The devices have to be reopened for the new profile to take effect
+            Globals::gAudio.setup();
+            onAllSoundsFinished();
+        }
+        if (settings.limiterMode != oldSettings.limiterMode || settings.limiterAttack != oldSettings.limiterAttack ||
+            settings.limiterRelease != oldSettings.limiterRelease ||
+            settings.limiterCeiling != oldSettings.limiterCeiling)
+        {
+            Globals::gAudio.updateLimiter();
+        }
+
 #if defined(__linux__)
         if (settings.audioBackend != oldSettings.audioBackend)
         {
@@ -618,9 +622,18 @@ namespace Soundux::Objects
             Globals::gAudioBackend = AudioBackend::createInstance(settings.audioBackend);
             Globals::gAudio.setup();
         }
+        else if (settings.pipeWireQuantum != oldSettings.pipeWireQuantum)
+        {
+            Globals::gAudio.setStreamQuantum(settings.pipeWireQuantum);
+        }
+        if (settings.duckMicrophone != oldSettings.duckMicrophone || settings.duckAmount != oldSettings.duckAmount ||
+            settings.duckAttack != oldSettings.duckAttack || settings.duckRelease != oldSettings.duckRelease)
+        {
+            Globals::gAudio.updateDucking();
+        }
         if (Globals::gAudioBackend)
         {
-            if (!Globals::gAudio.getPlayingSounds().empty())
+            if (!Globals::gAudio.getPlayingSounds().empty() && !Globals::gAudio.isDucking())
             {
                 if (settings.muteDuringPlayback && !oldSettings.muteDuringPlayback)
                 {
@@ -724,9 +737,15 @@ namespace Soundux::Objects
         if (tab)
         {
             tab->sounds = getTabContent(*tab);
+
+            //* Sounds the refresh removed should not be decoded anymore
+            Globals::gWaveforms.cancel(*tab);
             auto newTab = Globals::gData.setTab(id, *tab);
             if (newTab)
             {
+                Globals::gAudio.preload(getHotSounds(newTab->sounds));
+                Globals::gAudio.analyze(newTab->sounds);
+                Globals::gWaveforms.generate(*newTab);
                 return newTab;
             }
         }
@@ -755,11 +774,15 @@ namespace Soundux::Objects
     }
     std::optional<Sound> Window::setHotkey(const std::uint32_t &id, const std::vector<int> &hotkeys)
     {
-        auto sound = Globals::gData.getSound(id);
+        auto sound = Globals::gSounds.modify(id, [&](Sound &stored) { stored.hotkeys = hotkeys; });
         if (sound)
         {
-            sound->get().hotkeys = hotkeys;
-            return sound->get();
+            if (!hotkeys.empty())
+            {
+                Globals::gAudio.preload({*sound});
+            }
+
+            return sound;
         }
         Fancy::fancy.logTime().failure() << "Failed to set hotkey for sound " << id << ", sound does not exist"
                                          << std::endl;
@@ -923,15 +946,8 @@ namespace Soundux::Objects
         return Globals::gAudio.getAudioDevices();
     }
 #endif
-    void Window::onSoundFinished(const PlayingSound &sound)
+    void Window::onSoundFinished([[maybe_unused]] const PlayingSound &sound)
     {
-        auto scoped = groupedSounds.scoped();
-        if (scoped->find(sound.id) != scoped->end())
-        {
-            scoped->erase(sound.id);
-        }
-        scoped.unlock();
-
         if (Globals::gAudio.getPlayingSounds().size() == 1)
         {
             onAllSoundsFinished();
@@ -947,7 +963,7 @@ namespace Soundux::Objects
 #if defined(__linux__)
         if (Globals::gAudioBackend)
         {
-            if (Globals::gSettings.muteDuringPlayback)
+            if (Globals::gSettings.muteDuringPlayback && !Globals::gAudio.isDucking())
             {
                 if (!Globals::gAudioBackend->muteInput(false))
                 {
@@ -991,7 +1007,7 @@ namespace Soundux::Objects
         auto sound = Globals::gData.getSound(id);
         if (sound)
         {
-            if (!Helpers::deleteFile(sound->get().path, Globals::gSettings.deleteToTrash))
+            if (!Helpers::deleteFile(sound->path, Globals::gSettings.deleteToTrash))
             {
                 onError(Enums::ErrorCode::FailedToDelete);
                 return false;
@@ -1015,16 +1031,15 @@ namespace Soundux::Objects
             }
         }
 
-        auto soundsCopy = groupedSounds.copy();
-        for (const auto &[local, remote] : soundsCopy)
+        for (const auto &sound : Globals::gAudio.getPlayingSounds())
         {
             if (shouldPause)
             {
-                pauseSound(local);
+                pauseSound(sound.id);
             }
             else
             {
-                resumeSound(local);
+                resumeSound(sound.id);
             }
         }
 
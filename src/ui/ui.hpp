@@ -1,6 +1,7 @@
 #pragma once
 #include <core/objects/settings.hpp>
 #include <helper/audio/audio.hpp>
+#include <helper/audio/waveform/waveform.hpp>
 #if defined(__linux__)
 #include <helper/audio/linux/backend.hpp>
 #endif
@@ -8,7 +9,6 @@
 #include <cstdint>
 #include <queue>
 #include <string>
-#include <var_guard.hpp>
 
 namespace Soundux
 {
@@ -34,8 +34,6 @@ namespace Soundux
             friend class Hotkeys;
 
           protected:
-            sxl::var_guard<std::map<std::uint32_t, std::uint32_t>> groupedSounds;
-
             struct
             {
                 std::string exit;
@@ -91,6 +89,11 @@ namespace Soundux
             virtual std::optional<Sound> setHotkey(const std::uint32_t &, const std::vector<int> &);
             virtual std::optional<Sound> setCustomLocalVolume(const std::uint32_t &, const std::optional<int> &);
             virtual std::optional<Sound> setCustomRemoteVolume(const std::uint32_t &, const std::optional<int> &);
+            virtual std::optional<Sound> setSoundPriority(const std::uint32_t &, int);
+            virtual std::optional<Sound> setLoopRegion(const std::uint32_t &, std::uint64_t, std::uint64_t,
+                                                       std::uint64_t);
+            virtual std::optional<Sound> clearLoopRegion(const std::uint32_t &);
+            virtual std::optional<WaveformLevel> getWaveform(const std::uint32_t &, std::uint32_t);
 
           public:
             virtual ~Window();
@@ -105,7 +108,7 @@ namespace Soundux
             virtual void onError(const Enums::ErrorCode &) = 0;
             virtual void onSoundFinished(const PlayingSound &);
             virtual void onHotKeyReceived(const std::vector<int> &);
-            virtual void onSoundProgressed(const PlayingSound &) = 0;
+            virtual void onSoundsProgressed(const std::vector<PlayingSound> &) = 0;
             virtual void onDownloadProgressed(float, const std::string &) = 0;
         };
     } // namespace Objects